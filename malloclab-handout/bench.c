@@ -0,0 +1,169 @@
+/*
+ * bench.c - Repeated timing of a function f, reported as a median
+ *     with its median absolute deviation and a 95% confidence interval
+ *
+ * Each repetition is timed with CLOCK_MONOTONIC. Samples further than
+ * OUTLIER_MADS scaled MADs from the median (interrupts, page-cache
+ * hiccups, a migrating neighbor) are dropped before summarizing. The
+ * confidence interval for the median comes from order statistics, so
+ * it makes no assumption about the shape of the timing distribution.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+
+#include "bench.h"
+
+/* Default values */
+#define WARMUP 2          /* untimed runs */
+#define REPS 20           /* timed runs */
+#define OUTLIER_MADS 3.0  /* reject samples this many scaled MADs out */
+#define MAD_SCALE 1.4826  /* makes the MAD estimate sigma for normal data */
+
+static int warmup = WARMUP;
+static int reps = REPS;
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* median of the sorted array v[0..n-1] */
+static double median(double *v, int n)
+{
+    return (n % 2) ? v[n/2] : (v[n/2 - 1] + v[n/2]) / 2;
+}
+
+/* median absolute deviation of the sorted array v around m */
+static double mad(double *v, int n, double m)
+{
+    double *dev = malloc(n * sizeof(double)), result;
+    int i;
+
+    if (dev == NULL) {
+	fprintf(stderr, "Fatal error.  Malloc returned null in bench\n");
+	exit(1);
+    }
+    for (i = 0; i < n; i++)
+	dev[i] = fabs(v[i] - m);
+    qsort(dev, n, sizeof(double), cmp_double);
+    result = median(dev, n);
+    free(dev);
+    return result;
+}
+
+/*
+ * bench - Time reps runs of f(argp) and summarize them in *r
+ */
+void bench(bench_test_funct f, void *argp, bench_result_t *r)
+{
+    double *samples, start, m, d, limit;
+    int i, n, lo, hi;
+
+    if ((samples = malloc(reps * sizeof(double))) == NULL) {
+	fprintf(stderr, "Fatal error.  Malloc returned null in bench\n");
+	exit(1);
+    }
+
+    for (i = 0; i < warmup; i++)
+	f(argp);
+    for (i = 0; i < reps; i++) {
+	start = now();
+	f(argp);
+	samples[i] = now() - start;
+    }
+    qsort(samples, reps, sizeof(double), cmp_double);
+
+    /* Drop outliers; the survivors stay sorted and contiguous */
+    m = median(samples, reps);
+    limit = OUTLIER_MADS * MAD_SCALE * mad(samples, reps, m);
+    lo = 0;
+    hi = reps;
+    if (limit > 0) {
+	while (lo < hi && m - samples[lo] > limit)
+	    lo++;
+	while (hi > lo && samples[hi-1] - m > limit)
+	    hi--;
+    }
+    n = hi - lo;
+
+    r->n = n;
+    r->rejected = reps - n;
+    r->median = median(samples + lo, n);
+    r->mad = mad(samples + lo, n, r->median);
+
+    /* Order statistics bracketing the median with 95% confidence:
+       ranks n/2 -+ 1.96*sqrt(n)/2, by the normal approximation to
+       the binomial distribution */
+    d = 0.98 * sqrt(n);
+    i = (int)floor(n / 2.0 - d);
+    if (i < 0)
+	i = 0;
+    r->ci_lo = samples[lo + i];
+    i = (int)ceil(n / 2.0 + d);
+    if (i > n - 1)
+	i = n - 1;
+    r->ci_hi = samples[lo + i];
+
+    free(samples);
+}
+
+/* 
+ * set_bench_warmup - Untimed runs before the timed ones
+ *     Default = 2
+ */
+void set_bench_warmup(int warmup_arg)
+{
+    warmup = warmup_arg;
+}
+
+/* 
+ * set_bench_reps - Number of timed repetitions
+ *     Default = 20
+ */
+void set_bench_reps(int reps_arg)
+{
+    if (reps_arg > 0)
+	reps = reps_arg;
+}
+
+/* 
+ * bench_pin_cpu - Pin the calling process to one CPU
+ */
+int bench_pin_cpu(int cpu)
+{
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set);
+}
+
+/*
+ * bench_avoid_cpu - Run the calling process anywhere but one CPU
+ */
+int bench_avoid_cpu(int cpu)
+{
+    cpu_set_t set;
+    long i, n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    CPU_ZERO(&set);
+    for (i = 0; i < n && i < CPU_SETSIZE; i++)
+        if (i != cpu)
+            CPU_SET(i, &set);
+    if (CPU_COUNT(&set) == 0)
+        return -1;
+    return sched_setaffinity(0, sizeof(set), &set);
+}
@@ -0,0 +1,45 @@
+/*
+ * bench.h - repeated timing of a test function with warmup, CPU
+ *     pinning, outlier rejection and robust summary statistics
+ */
+
+/* The test function takes a generic pointer as input */
+typedef void (*bench_test_funct)(void *);
+
+/* Summary of the timed repetitions of one function */
+typedef struct {
+    int n;          /* samples kept after outlier rejection */
+    int rejected;   /* samples dropped as outliers */
+    double median;  /* median running time in seconds */
+    double mad;     /* median absolute deviation from the median */
+    double ci_lo;   /* 95% confidence interval for the median */
+    double ci_hi;
+} bench_result_t;
+
+/* Time f(argp) after the warmup runs and summarize into *r */
+void bench(bench_test_funct f, void *argp, bench_result_t *r);
+
+/* 
+ * set_bench_warmup - Untimed runs before the timed ones
+ *     Default = 2
+ */
+void set_bench_warmup(int warmup);
+
+/* 
+ * set_bench_reps - Number of timed repetitions
+ *     Default = 20
+ */
+void set_bench_reps(int reps);
+
+/* 
+ * bench_pin_cpu - Pin the calling process to one CPU so that
+ *     repetitions don't migrate; returns 0 on success, -1 otherwise
+ */
+int bench_pin_cpu(int cpu);
+
+/* 
+ * bench_avoid_cpu - Let the calling process run on every CPU except
+ *     cpu, so that helpers stay off a CPU pinned for timing; returns
+ *     0 on success, -1 otherwise (including when cpu is the only one)
+ */
+int bench_avoid_cpu(int cpu);
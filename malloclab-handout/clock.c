@@ -1,6 +1,6 @@
 /* 
- * clock.c - Routines for using the cycle counters on x86, 
- *           Alpha, and Sparc boxes.
+ * clock.c - Routines for using the cycle counters on x86, x86-64,
+ *           AArch64, Alpha, and Sparc boxes.
  * 
  * Copyright (c) 2002, R. Bryant and D. O'Hallaron, All rights reserved.
  * May not be used, modified, or copied without permission.
@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <time.h>
 #include <sys/times.h>
 #include "clock.h"
 
@@ -16,7 +17,7 @@
 /******************************************************* 
  * Machine dependent functions 
  *
- * Note: the constants __i386__ and  __alpha
+ * Note: the constants __i386__, __x86_64__, __aarch64__ and __alpha
  * are set by GCC when it calls the C preprocessor
  * You can verify this for yourself using gcc -v.
  *******************************************************/
@@ -71,6 +72,106 @@ double get_counter()
 }
 /* $end x86cyclecounter */
 
+#elif defined(__x86_64__)
+/*******************************************************
+ * x86-64 versions of start_counter() and get_counter()
+ *******************************************************/
+
+/* Initialize the cycle counter */
+static unsigned long long cyc_start = 0;
+
+/* Read the time-stamp counter at the start of a measurement. The
+   lfences keep the read from drifting into the code being timed. */
+static inline unsigned long long read_start_counter(void)
+{
+    unsigned hi, lo;
+    asm volatile("lfence; rdtsc; lfence"
+		 : "=d" (hi), "=a" (lo) : : "memory");
+    return ((unsigned long long)hi << 32) | lo;
+}
+
+/* Read the time-stamp counter at the end of a measurement. rdtscp
+   waits for the timed code to finish; the lfence keeps later code
+   from starting before the read. */
+static inline unsigned long long read_stop_counter(void)
+{
+    unsigned hi, lo, aux;
+    asm volatile("rdtscp; lfence"
+		 : "=d" (hi), "=a" (lo), "=c" (aux) : : "memory");
+    return ((unsigned long long)hi << 32) | lo;
+}
+
+/* Set *hi and *lo to the high and low order bits of the cycle counter. */
+void access_counter(unsigned *hi, unsigned *lo)
+{
+    unsigned long long c = read_start_counter();
+    *hi = (unsigned)(c >> 32);
+    *lo = (unsigned)c;
+}
+
+/* Record the current value of the cycle counter. */
+void start_counter()
+{
+    cyc_start = read_start_counter();
+}
+
+/* Return the number of cycles since the last call to start_counter. */
+double get_counter()
+{
+    return (double)(read_stop_counter() - cyc_start);
+}
+
+/* Does the TSC tick at a constant rate regardless of frequency
+   scaling and sleep states? (CPUID 0x80000007, EDX bit 8) */
+static int invariant_tsc()
+{
+    unsigned eax, ebx, ecx, edx;
+
+    asm volatile("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+		 : "a" (0x80000000));
+    if (eax < 0x80000007)
+	return 0;
+    asm volatile("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+		 : "a" (0x80000007));
+    return (edx >> 8) & 1;
+}
+
+#elif defined(__aarch64__)
+/*******************************************************
+ * AArch64 versions of start_counter() and get_counter()
+ *******************************************************/
+
+/* Initialize the cycle counter */
+static unsigned long long cyc_start = 0;
+
+/* Read the virtual counter; the isb keeps it in program order */
+static inline unsigned long long read_counter(void)
+{
+    unsigned long long c;
+    asm volatile("isb; mrs %0, cntvct_el0" : "=r" (c) : : "memory");
+    return c;
+}
+
+/* Record the current value of the cycle counter. */
+void start_counter()
+{
+    cyc_start = read_counter();
+}
+
+/* Return the number of counter ticks since the last call to start_counter. */
+double get_counter()
+{
+    return (double)(read_counter() - cyc_start);
+}
+
+/* The counter frequency in Hz, as set up by firmware */
+static unsigned long long counter_freq()
+{
+    unsigned long long f;
+    asm volatile("mrs %0, cntfrq_el0" : "=r" (f));
+    return f;
+}
+
 #elif defined(__alpha)
 
 /****************************************************
@@ -195,9 +296,42 @@ double mhz_full(int verbose, int sleeptime)
 }
 /* $end mhz */
 
-/* Version using a default sleeptime */
+#if defined(__x86_64__)
+/* Measure the rate of an invariant TSC against CLOCK_MONOTONIC over a
+   short busy wait; the rate is constant, so 50ms is plenty */
+static double mhz_tsc(int verbose)
+{
+    struct timespec t0, t1;
+    double ns, rate;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    start_counter();
+    do {
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    } while (ns < 50e6);
+    rate = get_counter() / (ns / 1e3);
+    if (verbose)
+	printf("Invariant TSC rate ~= %.1f MHz\n", rate);
+    return rate;
+}
+#endif
+
+/* Version using a default sleeptime, or the counter's known rate
+   where the hardware provides one */
 double mhz(int verbose)
 {
+#if defined(__x86_64__)
+    if (invariant_tsc())
+	return mhz_tsc(verbose);
+#elif defined(__aarch64__)
+    {
+	double rate = counter_freq() / 1e6;
+	if (verbose)
+	    printf("Counter frequency = %.1f MHz\n", rate);
+	return rate;
+    }
+#endif
     return mhz_full(verbose, 2);
 }
 
@@ -270,6 +404,9 @@ double get_comp_counter()
     times(&t);
     ticks = t.tms_utime - start_tick;
     ctime = time - ticks*cyc_per_tick;
+    /* a bad cyc_per_tick can't be allowed to make the time negative */
+    if (ctime <= 0)
+	ctime = time;
     /*
       printf("Measured %.0f cycles.  Ticks = %d.  Corrected %.0f cycles\n",
       time, (int) ticks, ctime);
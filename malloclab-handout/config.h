@@ -58,9 +58,16 @@
 
 /*****************************************************************************
  * Set exactly one of these USE_xxx constants to "1" to select a timing method
+ * By default the cycle counter is used wherever clock.c supports one.
  *****************************************************************************/
-#define USE_FCYC   0   /* cycle counter w/K-best scheme (x86 & Alpha only) */
+#if defined(__x86_64__) || defined(__aarch64__) || defined(__i386__) || defined(__alpha)
+#define USE_FCYC   1   /* cycle counter w/K-best scheme (x86, x86-64, AArch64 & Alpha) */
+#define USE_ITIMER 0   /* interval timer (any Unix box) */
+#define USE_GETTOD 0   /* gettimeofday (any Unix box) */
+#else
+#define USE_FCYC   0   /* cycle counter w/K-best scheme (x86, x86-64, AArch64 & Alpha) */
 #define USE_ITIMER 0   /* interval timer (any Unix box) */
 #define USE_GETTOD 1   /* gettimeofday (any Unix box) */
+#endif
 
 #endif /* __CONFIG_H */
@@ -26,7 +26,13 @@ void init_fsecs(void)
     /* set key parameters for the fcyc package */
     set_fcyc_maxsamples(20); 
     set_fcyc_clear_cache(1);
+#if defined(__x86_64__) || defined(__aarch64__)
+    /* these counters run at a fixed rate, and tickless kernels make the
+       times() ticks that compensation subtracts meaningless */
+    set_fcyc_compensate(0);
+#else
     set_fcyc_compensate(1);
+#endif
     set_fcyc_epsilon(0.01);
     set_fcyc_k(3);
     Mhz = mhz(verbose > 0);
@@ -17,11 +17,18 @@
 #include <math.h>
 #include <inttypes.h>
 #include <time.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/utsname.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 
 #include "mm.h"
 #include "memlib.h"
 #include "pagemap.h"
 #include "fsecs.h"
+#include "perfctr.h"
+#include "bench.h"
 #include "config.h"
 
 /**********************
@@ -32,6 +39,13 @@
 #define MAXLINE     1024 /* max string size */
 #define HDRLINES       4 /* number of header lines in a trace file */
 #define LINENUM(i) (i+5) /* cnvt trace request nums to linenums (origin 1) */
+#define BATCH_MAX     64 /* most trace ops grouped into one batch call (-b) */
+
+/* The memory the locality metric (-L) simulates */
+#define LOC_TLB_ENTRIES  64 /* fully associative LRU TLB of 4KB pages */
+#define LOC_CACHE_LINES 512 /* fully associative LRU cache of lines */
+#define LOC_LINE_SIZE    64
+#define LOC_TOUCH_LINES   4 /* lines at the start of a block that an op uses */
 
 /* Returns true if p is ALIGNMENT-byte aligned */
 #define IS_ALIGNED(p)  ((((uintptr_t)(p)) % ALIGNMENT) == 0)
@@ -52,6 +66,10 @@ typedef struct {
     enum {ALLOC, FREE, REALLOC} type; /* type of request */
     int index;                        /* index for free() to use later */
     int size;                         /* byte size of alloc/realloc request */
+    int align;                        /* alignment of a memalign request,
+                                         0 for plain allocs */
+    int nmemb;                        /* element count of a calloc request,
+                                         0 for plain allocs */
 } traceop_t;
 
 /* Holds the information for one trace file*/
@@ -75,6 +93,23 @@ typedef struct {
     range_t *ranges;
 } speed_t;
 
+/* A fully associative LRU cache of page or line numbers, for -L */
+typedef struct {
+    uintptr_t *tags;  /* most recently used first */
+    int size;         /* entries it can hold */
+    int used;
+    double misses;
+} lru_t;
+
+/* What the simulated TLB and cache saw over one run of a trace (-L) */
+typedef struct {
+    double touches;     /* lines touched */
+    double tlb_misses;
+    double line_misses;
+    double allocs;      /* allocs and reallocs */
+    double same_page;   /* of those, ones on the page of the one before */
+} locality_t;
+
 /* Summarizes the important stats for some malloc function on some trace */
 typedef struct {
     /* defined for both libc malloc and student malloc package (mm.c) */
@@ -87,9 +122,95 @@ typedef struct {
 
     double inst_util;     /* instanteous space utilization for this trace (always 0 for libc) */
 
+    /* defined only with -H */
+    double dtlb;          /* dTLB misses for one run with 4KB-page chunks (-1 if unknown) */
+    double dtlb_huge;     /* ... and with huge-page chunks */
+    double secs_huge;     /* secs with huge-page chunks */
+
+    /* defined only with -A, for an address-ordered free list */
+    int valid_ao;         /* the trace still checks out */
+    double util_ao;       /* util, inst_util and secs with it */
+    double inst_util_ao;
+    double secs_ao;
+
+    /* defined only with -L, with each placement policy */
+    locality_t loc;       /* MM_PLACE_LOCAL */
+    locality_t loc_ff;    /* MM_PLACE_FIRST_FIT */
+
+    /* defined only with -S */
+    double frees;         /* mm_free calls in one run of the trace */
+    double secs_sized;    /* secs with mm_free_sized for every free */
+
+    /* mm.c hot-path counters from the util run, if built with MM_STATS=1 */
+    int have_alloc;
+    mm_stats_t alloc;
+
+    /* memory use over the util run, as accounted by memlib */
+    double heap_peak;     /* peak mapped bytes */
+    double res_peak;      /* peak resident (mapped, not purged) bytes */
+    double res_avg;       /* average resident bytes per op */
+
+    /* real memory use over the util run, sampled with -i */
+    double rss_peak;      /* peak heap bytes resident according to mincore */
+    double rss_avg;       /* average of the samples */
+    double faults;        /* minor page faults during the run */
+    double res_util;      /* peak payload bytes over rss_peak */
+
+    /* usable bytes past the request, from mm_usable_size over the util run */
+    double allocs;        /* allocs and reallocs in the run */
+    double requested;     /* bytes they asked for */
+    double slack;         /* usable bytes they got past that */
+
+    /* defined only with -R */
+    double realloc_copied;   /* payload bytes mm_realloc copied */
+    double realloc_remapped; /* payload bytes mm_realloc remapped instead */
+
+    /* defined only with -B; secs is then the median */
+    bench_result_t bench;
+
+    /* hardware events during one speed run (-1 if unavailable), with -P */
+    double counters[PERFCTR_NUM_EVENTS];
+
+    /* per-op latency percentiles in ns, defined only with -o or -c */
+    double lat_p50, lat_p90, lat_p99, lat_max;
+
     /* Note: secs and util are only defined if valid is true */
 } stats_t; 
 
+/*
+ * Where a chaos run is, kept up to date as it goes so that a worker's
+ * state can still be read after the worker crashes
+ */
+typedef struct {
+    long seed;           /* random() seed the run started from */
+    int op;              /* trace op being run */
+    int mangles;         /* calls to mangle() so far */
+    size_t offset, len;  /* last mangle: bytes [offset, offset+len) of */
+    int value;           /*   every 16th-or-so page were set to value */
+    int changed;         /* whether any mangle so far changed a byte */
+    int false_check;     /* mm_check failed before any mangle changed
+                            anything */
+} chaos_state_t;
+
+/* 
+ * One forked worker for -j and -F: either the validity and util phases
+ * of a trace, or one chaos repeat of it
+ */
+typedef struct {
+    int trace;     /* index into the tracefiles */
+    int chaos;     /* 1 for a chaos repeat */
+    long seed;     /* random() seed for a chaos repeat */
+    chaos_state_t *state; /* shared with the worker, for chaos repeats */
+    pid_t pid;
+    int fd;        /* read end of the pipe carrying the job_result_t */
+} job_t;
+
+/* What a worker sends back to the driver */
+typedef struct {
+    stats_t stats;
+    int errors;
+} job_result_t;
+
 /********************
  * Global variables
  *******************/
@@ -105,6 +226,60 @@ static char *default_tracefiles[] = {
     DEFAULT_TRACEFILES, NULL
 };
 
+/* If set, realloc requests call mm_realloc instead of mm_malloc + mm_free (-R) */
+static int use_realloc = 0;
+
+/* If set, runs of same-size allocs and of frees go through
+   mm_malloc_batch and mm_free_batch in the correctness and speed
+   phases (-b) */
+static int use_batch = 0;
+
+/* If set, frees call mm_free_sized with the size the block was last
+   allocated with (-S) */
+static int use_sized_free = 0;
+
+/* The blocks of the last mm_malloc_batch call, for trace ops
+   batch_op to batch_op+batch_len-1 */
+static void *batch_blocks[BATCH_MAX];
+static int batch_op = 0, batch_len = 0;
+
+/* If set, time each trace with repeated runs and summary statistics (-B) */
+static int bench_mode = 0;
+
+/* Relative change in secs or util beyond which compare_results
+   calls a trace a regression (-x) */
+static double regress_threshold = 0.05;
+
+/* Ops between samples of the real resident heap size, 0 for none (-i) */
+static int rss_interval = 0;
+
+/* Per-op heap samples from eval_mm_util are written here (-T), one
+   record every series_every ops (-d); binary if the name ends in .bin */
+static FILE *series_file = NULL;
+static int series_binary = 0;
+static int series_every = 1;
+
+/* Failures printed in full by run_fuzz; the rest are only counted */
+#define FUZZ_MAX_REPORTS 20
+
+/* How a forked job ended (finish_job) */
+#define JOB_OK          0
+#define JOB_CRASHED     1  /* died without reporting */
+#define JOB_FALSE_CHECK 2  /* mm_check rejected an unchanged heap */
+#define JOB_ERRORS      3  /* chaos run hit errors mm_check let through */
+
+/* If clear, malloc_error only counts errors; fuzzing workers clear it
+   and leave the reporting to the driver */
+static int report_errors = 1;
+
+/* CPU the driver is pinned to for timing, or -1 (-p) */
+static int pin_cpu = -1;
+
+/* Progress of the current chaos run; workers point this at memory
+   shared with the driver */
+static chaos_state_t chaos_local;
+static chaos_state_t *chaos_state = &chaos_local;
+
 
 /********************* 
  * Function prototypes 
@@ -127,15 +302,45 @@ static void eval_libc_speed(void *ptr);
 /* Routines for evaluating correctnes, space utilization, and speed 
    of the student's malloc package in mm.c */
 static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges, int checks, int chaos);
-static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges, double *inst_ratio);
+static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges, stats_t *stats);
 static void eval_mm_speed(void *ptr);
+static void eval_mm_locality(trace_t *trace, locality_t *loc);
 
 /* Various helper routines */
 static int check(int chaos, const char *what);
 static int check_free(int chaos, void *p);
 static void check_post_free(int chaos, void *p);
+static void check_lookup(int chaos, char *p, int size);
+static int usable_size(int chaos, char *p, int size, int tracenum, int opnum);
+static char *mm_alloc_op(traceop_t *op);
+static char *libc_alloc_op(traceop_t *op);
+static char *batch_alloc(trace_t *trace, int i);
+static int batch_frees(trace_t *trace, int i, void **ptrs);
 static void mangle(void);
 static void printresults(int n, stats_t *stats);
+static void printhugeresults(int n, stats_t *stats);
+static void printsizedresults(int n, stats_t *stats);
+static void printorderresults(int n, stats_t *stats);
+static void printlocalityresults(int n, stats_t *stats);
+static void printreallocresults(int n, stats_t *stats);
+static void printmemresults(int n, stats_t *stats);
+static void printbenchresults(int n, stats_t *stats);
+static void printcounterresults(int n, stats_t *stats);
+static void printallocresults(int n, stats_t *stats);
+static void printslackresults(int n, stats_t *stats);
+static void count_speed(fsecs_test_funct f, speed_t *params, stats_t *stats);
+static void eval_mm_latency(trace_t *trace, stats_t *stats);
+static void write_results(char *filename, int n, char **names, stats_t *stats,
+                          double perfindex);
+static int compare_results(char *filename, int n, char **names, stats_t *stats);
+static double time_speed(fsecs_test_funct f, speed_t *params, stats_t *stats);
+static size_t heap_rss(void);
+static void open_series(char *filename);
+static void write_series(int tracenum, int opnum, size_t live, size_t heap);
+static void run_jobs(int njobs, char **tracefiles, int num_tracefiles,
+                     int checks, int repeats, stats_t *stats);
+static int run_fuzz(int njobs, int iters, char **tracefiles, int num_tracefiles);
+static int replay_chaos(long seed, char **tracefiles, int num_tracefiles);
 static void usage(void);
 static void unix_error(char *msg);
 static void malloc_error(int tracenum, int opnum, char *msg);
@@ -161,9 +366,25 @@ int main(int argc, char **argv)
     int autograder = 0;  /* If set, emit summary info for autograder (-g) */
     int checks = 1;      /* Whether to use mm_check and mm_can_free */
     int repeats = 1;     /* Number of times to try random chaos */
+    int huge_compare = 0; /* Compare 4KB and huge-page chunks (-H) */
+    int sized_compare = 0; /* Compare mm_free and mm_free_sized (-S) */
+    int order_compare = 0; /* Compare LIFO and address-ordered free lists (-A) */
+    int locality_compare = 0; /* Compare placement policies for locality (-L) */
+    int mem_report = 0;  /* Print resident memory use (-m) */
+    int slack_report = 0; /* Print usable-size slack (-U) */
+    int count_events = 0; /* Count hardware events per trace (-P) */
+    int njobs = 1;       /* Workers for the correctness and util phases (-j) */
+    int fuzz_iters = 0;  /* Seeded chaos runs in fuzzing mode (-F) */
+    int replay = 0;      /* Replay one chaos run (-z) */
+    long replay_seed = 0;
+    long long counts[PERFCTR_NUM_EVENTS];
 
     /* temporaries used to compute the performance index */
     double secs, ops, util, inst_util, avg_mm_inst_util, avg_mm_util, avg_mm_throughput;
+    double libc_throughput = AVG_LIBC_THRUPUT;
+    char *results_file = NULL;  /* write results as JSON here (-o) */
+    char *baseline_file = NULL; /* compare results against this (-c) */
+    int regressions = 0;
     double p1, p1i, p2, perfindex;
     int numcorrect;
   
@@ -172,7 +393,7 @@ int main(int argc, char **argv)
     /* 
      * Read and interpret the command line arguments 
      */
-    while ((c = getopt(argc, argv, "s:r:f:t:hqgaln")) != EOF) {
+    while ((c = getopt(argc, argv, "s:r:f:t:i:T:d:B:w:p:o:c:x:j:F:z:hqgalnbAHLRmPSU")) != EOF) {
         switch (c) {
         case 's':
             srandom(atoi(optarg));
@@ -204,6 +425,77 @@ int main(int argc, char **argv)
         case 'l': /* Run libc malloc */
             run_libc = 1;
             break;
+        case 'b': /* Group allocs and frees into batch calls */
+            use_batch = 1;
+            break;
+        case 'A': /* Compare LIFO and address-ordered free lists */
+            order_compare = 1;
+            break;
+        case 'L': /* Compare placement policies for locality */
+            locality_compare = 1;
+            break;
+        case 'H': /* Compare dTLB misses with huge-page chunks */
+            huge_compare = 1;
+            break;
+        case 'S': /* Free with mm_free_sized, and time it against mm_free */
+            sized_compare = 1;
+            use_sized_free = 1;
+            break;
+        case 'R': /* Use mm_realloc for realloc requests */
+            use_realloc = 1;
+            break;
+        case 'm': /* Print resident memory use */
+            mem_report = 1;
+            break;
+        case 'U': /* Print usable-size slack */
+            slack_report = 1;
+            break;
+        case 'P': /* Count hardware events per trace */
+            count_events = 1;
+            break;
+        case 'i': /* Sample real resident memory every <ops> ops */
+            rss_interval = atoi(optarg);
+            mem_report = 1;
+            break;
+        case 'T': /* Write a heap time series for each trace */
+            open_series(optarg);
+            break;
+        case 'B': /* Benchmark mode with <reps> timed repetitions */
+            bench_mode = 1;
+            set_bench_reps(atoi(optarg));
+            break;
+        case 'w': /* Untimed warmup runs in benchmark mode */
+            set_bench_warmup(atoi(optarg));
+            break;
+        case 'p': /* Pin to one CPU */
+            pin_cpu = atoi(optarg);
+            if (bench_pin_cpu(pin_cpu) < 0)
+                unix_error("Could not pin to the requested CPU");
+            break;
+        case 'j': /* Run correctness and util phases in <n> workers */
+            njobs = atoi(optarg);
+            break;
+        case 'F': /* Fuzz with <iters> seeded chaos runs */
+            fuzz_iters = atoi(optarg);
+            break;
+        case 'z': /* Replay the chaos run started from <seed> */
+            replay = 1;
+            replay_seed = atol(optarg);
+            break;
+        case 'o': /* Write machine-readable results */
+            results_file = optarg;
+            break;
+        case 'c': /* Compare against a stored baseline */
+            baseline_file = optarg;
+            break;
+        case 'x': /* Regression threshold in percent */
+            regress_threshold = atof(optarg) / 100.0;
+            break;
+        case 'd': /* Keep one time series sample every <n> ops */
+            series_every = atoi(optarg);
+            if (series_every < 1)
+                series_every = 1;
+            break;
         case 'q': /* Skip performance breakdown */
             verbose = 0;
             break;
@@ -216,6 +508,12 @@ int main(int argc, char **argv)
         }
     }
 	
+    /* Workers can't share the time series file */
+    if (njobs > 1 && series_file) {
+        fprintf(stderr, "mdriver: -j cannot be combined with -T\n");
+        exit(1);
+    }
+
     /* 
      * If no -f command line arg, then use the entire set of tracefiles 
      * defined in default_traces[]
@@ -226,8 +524,23 @@ int main(int argc, char **argv)
 	printf("Using default tracefiles in %s\n", tracedir);
     }
 
+    /* Fuzzing and replay only exercise mm_check and mm_can_free */
+    if (fuzz_iters > 0) {
+        if (njobs <= 1)
+            njobs = sysconf(_SC_NPROCESSORS_ONLN);
+        exit(run_fuzz(njobs, fuzz_iters, tracefiles, num_tracefiles) ? 1 : 0);
+    }
+    if (replay)
+        exit(replay_chaos(replay_seed, tracefiles, num_tracefiles) ? 1 : 0);
+
     /* Initialize the timing package */
     init_fsecs();
+    if ((huge_compare || count_events) && init_perfctr() == 0 && verbose)
+        printf("Hardware counters unavailable in this environment.\n");
+
+    /* Benchmark mode compares against libc measured on this machine */
+    if (bench_mode)
+        run_libc = 1;
 
     /*
      * Optionally run and evaluate the libc malloc package 
@@ -252,7 +565,9 @@ int main(int argc, char **argv)
 		speed_params.trace = trace;
 		if (verbose > 1)
 		    printf("and performance.\n");
-		libc_stats[i].secs = fsecs(eval_libc_speed, &speed_params);
+		libc_stats[i].secs = time_speed(eval_libc_speed, &speed_params, &libc_stats[i]);
+		if (count_events)
+		    count_speed(eval_libc_speed, &speed_params, &libc_stats[i]);
 	    }
 	    free_trace(trace);
 	}
@@ -261,6 +576,23 @@ int main(int argc, char **argv)
 	if (verbose) {
 	    printf("\nResults for libc malloc:\n");
 	    printresults(num_tracefiles, libc_stats);
+	    if (bench_mode) {
+		printf("\n");
+		printbenchresults(num_tracefiles, libc_stats);
+	    }
+	    if (count_events) {
+		printf("\n");
+		printcounterresults(num_tracefiles, libc_stats);
+	    }
+	}
+
+	if (bench_mode) {
+	    secs = ops = 0;
+	    for (i=0; i < num_tracefiles; i++) {
+		secs += libc_stats[i].secs;
+		ops += libc_stats[i].ops;
+	    }
+	    libc_throughput = ops/secs;
 	}
     }
 
@@ -278,17 +610,23 @@ int main(int argc, char **argv)
     /* Initialize the simulated memory system in memlib.c */
     mem_init(); 
 
+    /* With -j, the correctness and util phases run up front in workers */
+    if (njobs > 1)
+	run_jobs(njobs, tracefiles, num_tracefiles, checks, repeats, mm_stats);
+
     /* Evaluate student's mm malloc package using the K-best scheme */
     for (i=0; i < num_tracefiles; i++) {
         trace = read_trace(tracedir, tracefiles[i], i);
-	mm_stats[i].ops = trace->num_ops;
-	if (verbose > 1) {
-          printf("Checking mm_malloc for correctness, ");
-          fflush(stdout);
-        }
-	mm_stats[i].valid = eval_mm_valid(trace, i, &ranges, checks, 0);
+	if (njobs <= 1) {
+	  mm_stats[i].ops = trace->num_ops;
+	  if (verbose > 1) {
+            printf("Checking mm_malloc for correctness, ");
+            fflush(stdout);
+          }
+	  mm_stats[i].valid = eval_mm_valid(trace, i, &ranges, checks, 0);
+	}
 	if (mm_stats[i].valid) {
-          if (checks && (repeats > 0)) {
+          if (njobs <= 1 && checks && (repeats > 0)) {
             if (verbose > 1) {
               printf("defensiveness, ");
               fflush(stdout);
@@ -297,18 +635,66 @@ int main(int argc, char **argv)
               (void)eval_mm_valid(trace, i, &d_ranges, checks, 1);
           }
           
-          if (verbose > 1) {
-            printf("efficiency, ");
-            fflush(stdout);
+          if (njobs <= 1) {
+            if (verbose > 1) {
+              printf("efficiency, ");
+              fflush(stdout);
+            }
+            mm_stats[i].util = eval_mm_util(trace, i, &ranges, &mm_stats[i]);
           }
-          mm_stats[i].util = eval_mm_util(trace, i, &ranges, &mm_stats[i].inst_util);
           speed_params.trace = trace;
           speed_params.ranges = ranges;
           if (verbose > 1) {
             printf("and performance.\n");
             fflush(stdout);
           }
-          mm_stats[i].secs = fsecs(eval_mm_speed, &speed_params);
+          use_sized_free = 0; /* the sized run comes last */
+          mm_stats[i].secs = time_speed(eval_mm_speed, &speed_params, &mm_stats[i]);
+          if (count_events)
+            count_speed(eval_mm_speed, &speed_params, &mm_stats[i]);
+
+          if (results_file || baseline_file)
+            eval_mm_latency(trace, &mm_stats[i]);
+
+          if (huge_compare) {
+            perfctr_measure(eval_mm_speed, &speed_params, counts);
+            mm_stats[i].dtlb = counts[PERFCTR_DTLB_MISSES];
+            mem_set_huge(1);
+            perfctr_measure(eval_mm_speed, &speed_params, counts);
+            mm_stats[i].dtlb_huge = counts[PERFCTR_DTLB_MISSES];
+            mm_stats[i].secs_huge = fsecs(eval_mm_speed, &speed_params);
+            mem_set_huge(0);
+          }
+
+          if (order_compare) {
+            stats_t ao_stats;
+            memset(&ao_stats, 0, sizeof(ao_stats));
+            mm_set_free_order(MM_ORDER_ADDRESS);
+            mm_stats[i].valid_ao = eval_mm_valid(trace, i, &ranges, checks, 0);
+            if (mm_stats[i].valid_ao) {
+              mm_stats[i].util_ao = eval_mm_util(trace, i, &ranges, &ao_stats);
+              mm_stats[i].inst_util_ao = ao_stats.inst_util;
+              mm_stats[i].secs_ao = fsecs(eval_mm_speed, &speed_params);
+            }
+            mm_set_free_order(MM_ORDER_LIFO);
+          }
+
+          if (locality_compare) {
+            eval_mm_locality(trace, &mm_stats[i].loc);
+            mm_set_placement(MM_PLACE_FIRST_FIT);
+            eval_mm_locality(trace, &mm_stats[i].loc_ff);
+            mm_set_placement(MM_PLACE_LOCAL);
+          }
+
+          if (sized_compare) {
+            mm_stats[i].frees = 0;
+            for (j = 0; j < trace->num_ops; j++)
+              if (trace->ops[j].type == FREE
+                  || (trace->ops[j].type == REALLOC && !use_realloc))
+                mm_stats[i].frees++;
+            use_sized_free = 1;
+            mm_stats[i].secs_sized = fsecs(eval_mm_speed, &speed_params);
+          }
 	}
 	free_trace(trace);
     }
@@ -318,6 +704,54 @@ int main(int argc, char **argv)
 	printf("\nResults for mm malloc:\n");
 	printresults(num_tracefiles, mm_stats);
 	printf("\n");
+	if (bench_mode) {
+	    printbenchresults(num_tracefiles, mm_stats);
+	    printf("\n");
+	}
+	if (count_events) {
+	    printcounterresults(num_tracefiles, mm_stats);
+	    printf("\n");
+	}
+	if (huge_compare) {
+	    printf("Huge-page chunks (dTLB read misses per run):\n");
+	    printhugeresults(num_tracefiles, mm_stats);
+	    printf("\n");
+	}
+	if (order_compare) {
+	    printf("LIFO vs address-ordered free list:\n");
+	    printorderresults(num_tracefiles, mm_stats);
+	    printf("\n");
+	}
+	if (locality_compare) {
+	    printf("Locality, local placement vs first fit (simulated misses per line touched):\n");
+	    printlocalityresults(num_tracefiles, mm_stats);
+	    printf("\n");
+	}
+	if (sized_compare) {
+	    printf("mm_free vs mm_free_sized:\n");
+	    printsizedresults(num_tracefiles, mm_stats);
+	    printf("\n");
+	}
+	if (mem_report) {
+	    printf("Memory use (KB):\n");
+	    printmemresults(num_tracefiles, mm_stats);
+	    printf("\n");
+	}
+	if (slack_report) {
+	    printf("Usable bytes past each request:\n");
+	    printslackresults(num_tracefiles, mm_stats);
+	    printf("\n");
+	}
+	if (use_realloc) {
+	    printf("mm_realloc payload bytes moved:\n");
+	    printreallocresults(num_tracefiles, mm_stats);
+	    printf("\n");
+	}
+	if (mm_stats[0].have_alloc) {
+	    printf("mm hot-path counters (util run):\n");
+	    printallocresults(num_tracefiles, mm_stats);
+	    printf("\n");
+	}
     }
 
     /* 
@@ -347,13 +781,16 @@ int main(int argc, char **argv)
 
 	p1 = UTIL_WEIGHT * avg_mm_util;
 	p1i = UTIL_I_WEIGHT * avg_mm_inst_util;
-	if (avg_mm_throughput > AVG_LIBC_THRUPUT) {
+	if (avg_mm_throughput > libc_throughput) {
           p2 = (double)(1.0 - (UTIL_WEIGHT + UTIL_I_WEIGHT));
 	} 
 	else {
 	    p2 = ((double) (1.0 - (UTIL_WEIGHT + UTIL_I_WEIGHT))) * 
-		(avg_mm_throughput/AVG_LIBC_THRUPUT);
+		(avg_mm_throughput/libc_throughput);
 	}
+	if (bench_mode)
+	    printf("Throughput compared against libc measured at %.0f Kops/sec\n",
+		   libc_throughput/1e3);
 	
 	perfindex = (p1 + p1i + p2)*100.0;
 	printf("Perf index = %.0f (util) + %.0f (util_i) + %.0f (thru) = %.0f\n",
@@ -373,6 +810,18 @@ int main(int argc, char **argv)
 	printf("perfidx:%.0f\n", perfindex);
     }
 
+    if (series_file)
+	fclose(series_file);
+
+    if (results_file)
+	write_results(results_file, num_tracefiles, tracefiles, mm_stats, perfindex);
+    if (baseline_file)
+	regressions = compare_results(baseline_file, num_tracefiles, tracefiles, mm_stats);
+    if (regressions > 0) {
+	printf("%d trace(s) regressed against %s\n", regressions, baseline_file);
+	exit(2);
+    }
+
     exit(0);
 }
 
@@ -494,7 +943,7 @@ static trace_t *read_trace(char *tracedir, char *filename, int fn_index)
     trace_t *trace;
     char type[MAXLINE];
     char path[MAXLINE];
-    unsigned index, size;
+    unsigned index, size, align, nmemb;
     unsigned max_index = 0;
     unsigned op_index;
 
@@ -542,6 +991,34 @@ static trace_t *read_trace(char *tracedir, char *filename, int fn_index)
 	    trace->ops[op_index].type = ALLOC;
 	    trace->ops[op_index].index = index;
 	    trace->ops[op_index].size = size;
+	    trace->ops[op_index].align = 0;
+	    trace->ops[op_index].nmemb = 0;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
+	case 'c':
+	    fscanf(tracefile, "%u %u %u", &index, &nmemb, &size);
+	    if (nmemb == 0) {
+		printf("Bad element count %u in tracefile %s\n", nmemb, path);
+		exit(1);
+	    }
+	    trace->ops[op_index].type = ALLOC;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = nmemb * size;
+	    trace->ops[op_index].align = 0;
+	    trace->ops[op_index].nmemb = nmemb;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
+	case 'm':
+	    fscanf(tracefile, "%u %u %u", &index, &align, &size);
+	    if (align == 0 || (align & (align - 1)) != 0) {
+		printf("Bad alignment %u in tracefile %s\n", align, path);
+		exit(1);
+	    }
+	    trace->ops[op_index].type = ALLOC;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = size;
+	    trace->ops[op_index].align = align;
+	    trace->ops[op_index].nmemb = 0;
 	    max_index = (index > max_index) ? index : max_index;
 	    break;
 	case 'r':
@@ -549,6 +1026,8 @@ static trace_t *read_trace(char *tracedir, char *filename, int fn_index)
 	    trace->ops[op_index].type = REALLOC;
 	    trace->ops[op_index].index = index;
 	    trace->ops[op_index].size = size;
+	    trace->ops[op_index].align = 0;
+	    trace->ops[op_index].nmemb = 0;
 	    max_index = (index > max_index) ? index : max_index;
 	    break;
 	case 'f':
@@ -593,9 +1072,9 @@ void free_trace(trace_t *trace)
  */
 static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges, int checks, int chaos)
 {
-    int i, non_free_op = 0;
+    int i, j, non_free_op = 0;
     int index;
-    int size;
+    int size, oldsize, usable;
     char *newp;
     char *oldp;
     char *p;
@@ -608,9 +1087,11 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges, int che
 	malloc_error(tracenum, 0, "mm_init failed.");
 	return 0;
     }
+    batch_len = 0;
 
     /* Interpret each operation in the trace in order */
     for (i = 0;  i < trace->num_ops;  i++) {
+        chaos_state->op = i;
         if (checks) {
           if (trace->ops[i].type != FREE) {
             /* check that freed pointers since last alloc are
@@ -631,10 +1112,18 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges, int che
         case ALLOC: /* mm_malloc */
 
 	    /* Call the student's malloc */
-	    if ((p = mm_malloc(size)) == NULL) {
+	    p = use_batch ? batch_alloc(trace, i) : mm_alloc_op(&trace->ops[i]);
+	    if (p == NULL) {
 		malloc_error(tracenum, i, "mm_malloc failed.");
 		return 0;
 	    }
+	    if (trace->ops[i].align
+		&& ((uintptr_t)p % trace->ops[i].align) != 0) {
+		sprintf(msg, "mm_memalign returned a block not aligned to %d bytes",
+			trace->ops[i].align);
+		malloc_error(tracenum, i, msg);
+		return 0;
+	    }
             if (checks && !check(chaos, "malloc"))
               return 0;
 	    
@@ -643,25 +1132,80 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges, int che
 	     * to the range list if OK. The block must be  be aligned properly,
 	     * and must not overlap any currently allocated block. 
 	     */ 
-	    if (add_range(ranges, p, size, tracenum, i) == 0)
+	    if ((usable = usable_size(chaos, p, size, tracenum, i)) == 0)
 		return 0;
+	    if (add_range(ranges, p, usable, tracenum, i) == 0)
+		return 0;
+            if (checks)
+              check_lookup(chaos, p, usable);
+
+	    /* A calloc block must come back cleared (chaos may have
+	       scribbled on free memory, so only check without it) */
+	    if (trace->ops[i].nmemb && !chaos) {
+		for (j = 0; j < size; j++) {
+		    if (p[j] != 0) {
+			malloc_error(tracenum, i, "mm_calloc returned a block that is not zeroed");
+			return 0;
+		    }
+		}
+	    }
 	    
 	    /* ADDED: cgw
 	     * fill range with low byte of index.  This will be used later
 	     * if we realloc the block and wish to make sure that the old
-	     * data was copied to the new block
+	     * data was copied to the new block. All of the usable size is
+	     * written, to make sure it is really the caller's.
 	     */
-	    memset(p, index & 0xFF, size);
+	    memset(p, index & 0xFF, usable);
 
 	    /* Remember region */
 	    trace->blocks[index] = p;
 	    trace->block_sizes[index] = size;
 	    break;
 
-        case REALLOC: /* mm_malloc + mm_free */
+        case REALLOC: /* mm_realloc, or mm_malloc + mm_free */
 	    
 	    /* Call the student's realloc */
 	    oldp = trace->blocks[index];
+	    if (use_realloc) {
+		oldsize = trace->block_sizes[index];
+		if ((newp = mm_realloc(oldp, size)) == NULL) {
+		    malloc_error(tracenum, i, "mm_realloc failed.");
+		    return 0;
+		}
+		if (checks && !check(chaos, "malloc"))
+		    return 0;
+
+		remove_range(ranges, oldp);
+		if ((usable = usable_size(chaos, newp, size, tracenum, i)) == 0)
+		    return 0;
+		if (add_range(ranges, newp, usable, tracenum, i) == 0)
+		    return 0;
+		if (checks)
+		    check_lookup(chaos, newp, usable);
+
+		/* The old contents must have been carried over (chaos
+		   may have scribbled on them, so only check without it) */
+		if (!chaos) {
+		    if (size < oldsize)
+			oldsize = size;
+		    for (j = 0; j < oldsize; j++) {
+			if ((unsigned char)newp[j] != (index & 0xFF)) {
+			    malloc_error(tracenum, i, "mm_realloc did not preserve the data from old block");
+			    return 0;
+			}
+		    }
+		}
+		memset(newp, index & 0xFF, usable);
+
+		if (checks && newp != oldp)
+		    check_post_free(chaos, oldp);
+
+		trace->blocks[index] = newp;
+		trace->block_sizes[index] = size;
+		break;
+	    }
+
 	    if ((newp = mm_malloc(size)) == NULL) {
 		malloc_error(tracenum, i, "mm_malloc failed.");
 		return 0;
@@ -673,13 +1217,20 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges, int che
 	    remove_range(ranges, oldp);
 	    
 	    /* Check new block for correctness and add it to range list */
-	    if (add_range(ranges, newp, size, tracenum, i) == 0)
+	    if ((usable = usable_size(chaos, newp, size, tracenum, i)) == 0)
 		return 0;
-	    memset(newp, index & 0xFF, size);
+	    if (add_range(ranges, newp, usable, tracenum, i) == 0)
+		return 0;
+            if (checks)
+              check_lookup(chaos, newp, usable);
+	    memset(newp, index & 0xFF, usable);
 
             if (checks && !check_free(chaos, oldp))
               return 0;
-            mm_free(oldp);
+            if (use_sized_free)
+              mm_free_sized(oldp, trace->block_sizes[index]);
+            else
+              mm_free(oldp);
             if (checks && !check(chaos, "free"))
               return 0;
             if (checks)
@@ -692,12 +1243,31 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges, int che
 
         case FREE: /* mm_free */
 	    
+	    if (use_batch) {
+		void *ptrs[BATCH_MAX];
+		int n = batch_frees(trace, i, ptrs);
+
+		for (j = 0; j < n; j++) {
+		    remove_range(ranges, ptrs[j]);
+		    if (checks && !check_free(chaos, ptrs[j]))
+			return 0;
+		}
+		mm_free_batch(ptrs, n);
+		if (checks && !check(chaos, "free"))
+		    return 0;
+		i += n - 1;
+		break;
+	    }
+
 	    /* Remove region from list and call student's free function */
 	    p = trace->blocks[index];
 	    remove_range(ranges, p);
             if (checks && !check_free(chaos, p))
               return 0;
-            mm_free(p);
+            if (use_sized_free)
+              mm_free_sized(p, trace->block_sizes[index]);
+            else
+              mm_free(p);
             if (checks && !check(chaos, "free"))
               return 0;
 	    break;
@@ -725,15 +1295,23 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges, int che
  *   is always the high water mark of the heap. 
  *   
  */
-static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges, double *inst_ratio)
+static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges, stats_t *stats)
 {   
     int i;
     int index;
     int size, newsize, oldsize;
     size_t max_total_size = 0, max_heap_size = 0;
     size_t heap_size = 0, total_size = 0;
+    size_t res_size, max_res_size = 0;
+    double accum_res_size = 0;
+    size_t rss, max_rss = 0;
+    double accum_rss = 0;
+    int rss_samples = 0;
+    struct rusage usage;
+    long start_faults;
     double ratio, ratio_frac, accum_ratio_frac = 1.0, accum_ratio_exp = 0.0;
     int ratio_exp;
+    double allocs = 0, slack = 0, requested = 0;
     char *p;
     char *newp, *oldp;
 
@@ -741,6 +1319,9 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges, doubl
     if (mm_init() < 0)
 	app_error("mm_init failed in eval_mm_util");
 
+    getrusage(RUSAGE_SELF, &usage);
+    start_faults = usage.ru_minflt;
+
     for (i = 0;  i < trace->num_ops;  i++) {
         switch (trace->ops[i].type) {
 
@@ -748,8 +1329,13 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges, doubl
 	    index = trace->ops[i].index;
 	    size = trace->ops[i].size;
 
-	    if ((p = mm_malloc(size)) == NULL) 
+	    if ((p = mm_alloc_op(&trace->ops[i])) == NULL) 
 		app_error("mm_malloc failed in eval_mm_util");
+
+	    /* When measuring real memory, use the block the way a
+	       program would, so that its pages become resident */
+	    if (rss_interval > 0)
+		memset(p, index & 0xFF, size);
 	    
 	    /* Remember region and size */
 	    trace->blocks[index] = p;
@@ -759,6 +1345,10 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges, doubl
 	     * of all allocated blocks */
 	    total_size += size;
 
+	    allocs++;
+	    slack += mm_usable_size(p) - size;
+	    requested += size;
+
             break;
 
 	case REALLOC: /* mm_mealloc + mm_free */
@@ -767,10 +1357,16 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges, doubl
 	    oldsize = trace->block_sizes[index];
 
 	    oldp = trace->blocks[index];
-	    if ((newp = mm_malloc(newsize)) == NULL)
-		app_error("mm_realloc failed in eval_mm_util");
-
-            mm_free(oldp);
+	    if (use_realloc) {
+		if ((newp = mm_realloc(oldp, newsize)) == NULL)
+		    app_error("mm_realloc failed in eval_mm_util");
+	    } else {
+		if ((newp = mm_malloc(newsize)) == NULL)
+		    app_error("mm_realloc failed in eval_mm_util");
+		mm_free(oldp);
+	    }
+	    if (rss_interval > 0)
+		memset(newp, index & 0xFF, newsize);
 
 	    /* Remember region and size */
 	    trace->blocks[index] = newp;
@@ -779,6 +1375,10 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges, doubl
 	    /* Keep track of current total size
 	     * of all allocated blocks */
 	    total_size += (newsize - oldsize);
+
+	    allocs++;
+	    slack += mm_usable_size(newp) - newsize;
+	    requested += newsize;
             
 	    break;
 
@@ -810,6 +1410,24 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges, doubl
         if (heap_size > max_heap_size)
           max_heap_size = heap_size;
 
+        res_size = mem_residentsize();
+        if (res_size > max_res_size)
+          max_res_size = res_size;
+        accum_res_size += res_size;
+
+        if (series_file
+            && (i % series_every == 0 || i == trace->num_ops - 1))
+          write_series(tracenum, i, total_size, heap_size);
+
+        if (rss_interval > 0
+            && (i % rss_interval == 0 || i == trace->num_ops - 1)) {
+          rss = heap_rss();
+          if (rss > max_rss)
+            max_rss = rss;
+          accum_rss += rss;
+          rss_samples++;
+        }
+
         ratio = (double)(total_size + 1) / (heap_size + 1);
 
         ratio_frac = frexp(ratio, &ratio_exp);
@@ -823,18 +1441,145 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges, doubl
         // printf("%ld %ld %f\n", total_size, heap_size, ratio);
     }
 
+    stats->heap_peak = max_heap_size;
+    stats->res_peak = max_res_size;
+    stats->res_avg = accum_res_size / trace->num_ops;
+
+    if (rss_interval > 0) {
+        getrusage(RUSAGE_SELF, &usage);
+        stats->faults = usage.ru_minflt - start_faults;
+        stats->rss_peak = max_rss;
+        stats->rss_avg = accum_rss / rss_samples;
+        stats->res_util = (double)max_total_size / (max_rss ? max_rss : 1);
+    }
+
+    stats->have_alloc = mm_stats(&stats->alloc);
+
+    stats->allocs = allocs;
+    stats->requested = requested;
+    stats->slack = slack;
+
+    if (use_realloc) {
+        size_t copied, remapped;
+        mm_realloc_stats(&copied, &remapped);
+        stats->realloc_copied = copied;
+        stats->realloc_remapped = remapped;
+    }
+
     mem_reset();
 
     ratio = accum_ratio_frac * pow(2, accum_ratio_exp / trace->num_ops);
 
     // printf("%ld %f\n", max_total_size, ratio);
 
-    *inst_ratio = ratio;
+    stats->inst_util = ratio;
 
     return (double)max_total_size / max_heap_size;;
 }
 
 
+/*
+ * lru_touch - look tag up in lru, counting a miss if it isn't there,
+ *     and make it the most recently used entry
+ */
+static void lru_touch(lru_t *lru, uintptr_t tag)
+{
+    int i;
+
+    for (i = 0; i < lru->used && lru->tags[i] != tag; i++)
+	;
+    if (i == lru->used) {
+	lru->misses++;
+	if (lru->used < lru->size)
+	    lru->used++;
+	i = lru->used - 1;
+    }
+    memmove(lru->tags + 1, lru->tags, i * sizeof(uintptr_t));
+    lru->tags[0] = tag;
+}
+
+/*
+ * touch_block - the program's side of an op: it uses the first
+ *     LOC_TOUCH_LINES lines of the block
+ */
+static void touch_block(lru_t *tlb, lru_t *cache, locality_t *loc, char *p, int size)
+{
+    uintptr_t line = (uintptr_t)p / LOC_LINE_SIZE;
+    uintptr_t last = ((uintptr_t)p + (size > 0 ? size - 1 : 0)) / LOC_LINE_SIZE;
+
+    if (last >= line + LOC_TOUCH_LINES)
+	last = line + LOC_TOUCH_LINES - 1;
+    for (; line <= last; line++) {
+	loc->touches++;
+	lru_touch(tlb, line * LOC_LINE_SIZE / mem_pagesize());
+	lru_touch(cache, line);
+    }
+}
+
+/*
+ * eval_mm_locality - replay the trace while a simulated TLB and cache
+ *     follow the blocks it uses, to see how well the allocator keeps
+ *     blocks that are used together on the same lines and pages
+ */
+static void eval_mm_locality(trace_t *trace, locality_t *loc)
+{
+    uintptr_t tlb_tags[LOC_TLB_ENTRIES], cache_tags[LOC_CACHE_LINES];
+    lru_t tlb = {tlb_tags, LOC_TLB_ENTRIES, 0, 0};
+    lru_t cache = {cache_tags, LOC_CACHE_LINES, 0, 0};
+    uintptr_t page, last_page = 0;
+    int i, index, size;
+    char *p, *oldp;
+
+    memset(loc, 0, sizeof(*loc));
+    if (mm_init() < 0)
+	app_error("mm_init failed in eval_mm_locality");
+
+    for (i = 0; i < trace->num_ops; i++) {
+	index = trace->ops[i].index;
+	size = trace->ops[i].size;
+	switch (trace->ops[i].type) {
+
+	case ALLOC: /* mm_malloc */
+	    if ((p = mm_alloc_op(&trace->ops[i])) == NULL)
+		app_error("mm_malloc failed in eval_mm_locality");
+	    break;
+
+	case REALLOC: /* mm_realloc, or mm_malloc + mm_free */
+	    oldp = trace->blocks[index];
+	    if (use_realloc) {
+		if ((p = mm_realloc(oldp, size)) == NULL)
+		    app_error("mm_realloc failed in eval_mm_locality");
+	    } else {
+		if ((p = mm_malloc(size)) == NULL)
+		    app_error("mm_realloc failed in eval_mm_locality");
+		mm_free(oldp);
+	    }
+	    break;
+
+	case FREE: /* mm_free, after the block's last use */
+	    p = trace->blocks[index];
+	    touch_block(&tlb, &cache, loc, p, trace->block_sizes[index]);
+	    mm_free(p);
+	    continue;
+
+	default:
+	    app_error("Nonexistent request type in eval_mm_locality");
+	}
+
+	trace->blocks[index] = p;
+	trace->block_sizes[index] = size;
+	page = (uintptr_t)p / mem_pagesize();
+	if (loc->allocs > 0 && page == last_page)
+	    loc->same_page++;
+	last_page = page;
+	loc->allocs++;
+	touch_block(&tlb, &cache, loc, p, size);
+    }
+
+    loc->tlb_misses = tlb.misses;
+    loc->line_misses = cache.misses;
+}
+
 /*
  * eval_mm_speed - This is the function that is used by fcyc()
  *    to measure the running time of the mm malloc package.
@@ -848,6 +1593,7 @@ static void eval_mm_speed(void *ptr)
     /* Reset the heap and initialize the mm package */
     if (mm_init() < 0) 
 	app_error("mm_init failed in eval_mm_speed");
+    batch_len = 0;
 
     /* Interpret each trace request */
     for (i = 0;  i < trace->num_ops;  i++)
@@ -856,25 +1602,46 @@ static void eval_mm_speed(void *ptr)
         case ALLOC: /* mm_malloc */
             index = trace->ops[i].index;
             size = trace->ops[i].size;
-            if ((p = mm_malloc(size)) == NULL)
+            p = use_batch ? batch_alloc(trace, i) : mm_alloc_op(&trace->ops[i]);
+            if (p == NULL)
 		app_error("mm_malloc error in eval_mm_speed");
             trace->blocks[index] = p;
+            trace->block_sizes[index] = size;
             break;
 
-	case REALLOC: /* mm_malloc + mm_free */
+	case REALLOC: /* mm_realloc, or mm_malloc + mm_free */
 	    index = trace->ops[i].index;
             newsize = trace->ops[i].size;
 	    oldp = trace->blocks[index];
-            if ((newp = mm_malloc(newsize)) == NULL)
-		app_error("mm_realloc error in eval_mm_speed");
-            mm_free(oldp);
+            if (use_realloc) {
+                if ((newp = mm_realloc(oldp, newsize)) == NULL)
+                    app_error("mm_realloc error in eval_mm_speed");
+            } else {
+                if ((newp = mm_malloc(newsize)) == NULL)
+                    app_error("mm_realloc error in eval_mm_speed");
+                if (use_sized_free)
+                    mm_free_sized(oldp, trace->block_sizes[index]);
+                else
+                    mm_free(oldp);
+            }
             trace->blocks[index] = newp;
+            trace->block_sizes[index] = newsize;
             break;
 
         case FREE: /* mm_free */
+            if (use_batch) {
+                void *ptrs[BATCH_MAX];
+                int n = batch_frees(trace, i, ptrs);
+                mm_free_batch(ptrs, n);
+                i += n - 1;
+                break;
+            }
             index = trace->ops[i].index;
             block = trace->blocks[index];
-            mm_free(block);
+            if (use_sized_free)
+                mm_free_sized(block, trace->block_sizes[index]);
+            else
+                mm_free(block);
             break;
 
 	default:
@@ -884,6 +1651,70 @@ static void eval_mm_speed(void *ptr)
     mem_reset();
 }
 
+/*
+ * eval_mm_latency - Replay the trace once more, timing every request
+ *    on its own, and record the latency percentiles in *stats.
+ */
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void eval_mm_latency(trace_t *trace, stats_t *stats)
+{
+    int i, index, n = trace->num_ops;
+    char *p, *oldp;
+    double *lat;
+    struct timespec t0, t1;
+
+    if ((lat = malloc(n * sizeof(double))) == NULL)
+	unix_error("malloc failed in eval_mm_latency");
+
+    if (mm_init() < 0) 
+	app_error("mm_init failed in eval_mm_latency");
+
+    for (i = 0;  i < n;  i++) {
+	index = trace->ops[i].index;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+        switch (trace->ops[i].type) {
+        case ALLOC:
+            if ((p = mm_alloc_op(&trace->ops[i])) == NULL)
+		app_error("mm_malloc error in eval_mm_latency");
+            trace->blocks[index] = p;
+            break;
+	case REALLOC:
+	    oldp = trace->blocks[index];
+            if (use_realloc) {
+                if ((p = mm_realloc(oldp, trace->ops[i].size)) == NULL)
+                    app_error("mm_realloc error in eval_mm_latency");
+            } else {
+                if ((p = mm_malloc(trace->ops[i].size)) == NULL)
+                    app_error("mm_realloc error in eval_mm_latency");
+                mm_free(oldp);
+            }
+            trace->blocks[index] = p;
+            break;
+        case FREE:
+            mm_free(trace->blocks[index]);
+            break;
+	default:
+	    app_error("Nonexistent request type in eval_mm_latency");
+        }
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	lat[i] = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    }
+
+    mem_reset();
+
+    qsort(lat, n, sizeof(double), cmp_double);
+    stats->lat_p50 = lat[(int)(0.50 * (n - 1))];
+    stats->lat_p90 = lat[(int)(0.90 * (n - 1))];
+    stats->lat_p99 = lat[(int)(0.99 * (n - 1))];
+    stats->lat_max = lat[n - 1];
+    free(lat);
+}
+
 /*
  * eval_libc_valid - We run this function to make sure that the
  *    libc malloc can run to completion on the set of traces.
@@ -899,7 +1730,7 @@ static int eval_libc_valid(trace_t *trace, int tracenum)
         switch (trace->ops[i].type) {
 
         case ALLOC: /* malloc */
-	    if ((p = malloc(trace->ops[i].size)) == NULL) {
+	    if ((p = libc_alloc_op(&trace->ops[i])) == NULL) {
 		malloc_error(tracenum, i, "libc malloc failed");
 		unix_error("System message");
 	    }
@@ -936,7 +1767,7 @@ static int eval_libc_valid(trace_t *trace, int tracenum)
 static void eval_libc_speed(void *ptr)
 {
     int i;
-    int index, size, newsize;
+    int index, newsize;
     char *p, *newp, *oldp, *block;
     trace_t *trace = ((speed_t *)ptr)->trace;
 
@@ -944,8 +1775,7 @@ static void eval_libc_speed(void *ptr)
         switch (trace->ops[i].type) {
         case ALLOC: /* malloc */
 	    index = trace->ops[i].index;
-	    size = trace->ops[i].size;
-	    if ((p = malloc(size)) == NULL)
+	    if ((p = libc_alloc_op(&trace->ops[i])) == NULL)
 		unix_error("malloc failed in eval_libc_speed");
 	    trace->blocks[index] = p;
 	    break;
@@ -954,9 +1784,14 @@ static void eval_libc_speed(void *ptr)
 	    index = trace->ops[i].index;
 	    newsize = trace->ops[i].size;
 	    oldp = trace->blocks[index];
-	    if ((newp = malloc(newsize)) == NULL)
-		unix_error("malloc failed in eval_libc_speed\n");
-            free(oldp);
+	    if (use_realloc) {
+		if ((newp = realloc(oldp, newsize)) == NULL)
+		    unix_error("realloc failed in eval_libc_speed\n");
+	    } else {
+		if ((newp = malloc(newsize)) == NULL)
+		    unix_error("malloc failed in eval_libc_speed\n");
+		free(oldp);
+	    }
 	    
 	    trace->blocks[index] = newp;
 	    break;
@@ -970,51 +1805,644 @@ static void eval_libc_speed(void *ptr)
     }
 }
 
-/*************************************
- * Some miscellaneous helper routines
- ************************************/
+/*
+ * heap_rss - Count the bytes of mapped heap pages that are actually
+ *     resident, using mincore on each run of adjacent pages.
+ */
+static char *rss_lo, *rss_hi;  /* the current run of adjacent pages */
+static size_t rss_pages;
+static unsigned char *rss_vec;
+static size_t rss_vec_len;
 
-static int check(int chaos, const char *what)
+static void rss_flush(void)
 {
-  if (chaos) {
-    mangle();
-    if (!mm_check()) {
-      mem_reset();
-      return 0;
-    }
-  } else {
-    if (!mm_check()) {
-      if (!strcmp(what, "alloc"))
-        app_error("mm_check failed after alloc");
-      else
-        app_error("mm_check failed after free");
+    size_t n = (rss_hi - rss_lo) / mem_pagesize(), j;
+
+    if (n == 0)
+	return;
+    if (n > rss_vec_len) {
+	rss_vec_len = 2*n;
+	if ((rss_vec = realloc(rss_vec, rss_vec_len)) == NULL)
+	    unix_error("realloc failed in rss_flush");
     }
-  }
-
-  return 1;
+    if (mincore(rss_lo, rss_hi - rss_lo, rss_vec) < 0)
+	unix_error("mincore failed in rss_flush");
+    for (j = 0; j < n; j++)
+	rss_pages += rss_vec[j] & 1;
 }
 
-static int check_free(int chaos, void *p)
-{  
-  if (chaos) {
-    if (!mm_can_free(p)) {
-      mem_reset();
-      return 0;
-    }
-    if (mm_can_free(p + 8))
-      mm_free(p+8);
-    if (mm_can_free(p - 8))
-      mm_free(p-8);
-  } else {
-    if (!mm_can_free(p)) {
-      app_error("mm_can_free incorrectly claimed unfreeable");
+static void rss_page(void *addr)
+{
+    char *p = addr;
+
+    if (p == rss_hi)
+	rss_hi += mem_pagesize();
+    else if (p + mem_pagesize() == rss_lo)
+	rss_lo = p;
+    else {
+	rss_flush();
+	rss_lo = p;
+	rss_hi = p + mem_pagesize();
     }
-  }
+}
 
-  return 1;
+static size_t heap_rss(void)
+{
+    rss_pages = 0;
+    rss_lo = rss_hi = NULL;
+    pagemap_for_each(rss_page, 0);
+    rss_flush();
+    return rss_pages * mem_pagesize();
 }
 
-static void check_post_free(int chaos, void *p)
+/*
+ * open_series - Start the heap time series file. A CSV file gets a
+ *     header line; a .bin file holds series_rec_t records instead.
+ */
+typedef struct {
+    uint64_t trace, op, live, heap, free_blocks, largest_free;
+} series_rec_t;
+
+static void open_series(char *filename)
+{
+    size_t len = strlen(filename);
+
+    if ((series_file = fopen(filename, "w")) == NULL) {
+	sprintf(msg, "Could not open %s for the time series", filename);
+	unix_error(msg);
+    }
+    series_binary = (len > 4 && !strcmp(filename + len - 4, ".bin"));
+    if (!series_binary)
+	fprintf(series_file, "trace,op,live_bytes,heap_bytes,free_blocks,largest_free\n");
+}
+
+/*
+ * write_series - Add one sample of the heap state to the time series
+ */
+static void write_series(int tracenum, int opnum, size_t live, size_t heap)
+{
+    size_t free_blocks, largest_free;
+
+    mm_free_summary(&free_blocks, &largest_free);
+    if (series_binary) {
+	series_rec_t rec = { tracenum, opnum, live, heap, free_blocks, largest_free };
+	fwrite(&rec, sizeof(rec), 1, series_file);
+    } else
+	fprintf(series_file, "%d,%d,%lu,%lu,%lu,%lu\n", tracenum, opnum,
+		(unsigned long)live, (unsigned long)heap,
+		(unsigned long)free_blocks, (unsigned long)largest_free);
+}
+
+/*****************************************************************
+ * The following routines write results as JSON and compare them
+ * against a stored baseline. Each trace is one line of the "traces"
+ * array, which is all compare_results needs to read them back.
+ ****************************************************************/
+
+/* 
+ * write_env - Describe the machine and build the results came from
+ */
+static void write_env(FILE *f)
+{
+    struct utsname u;
+    char line[MAXLINE], cpu[MAXLINE] = "unknown", *c;
+    FILE *info;
+
+    uname(&u);
+    if ((info = fopen("/proc/cpuinfo", "r")) != NULL) {
+	while (fgets(line, MAXLINE, info)) {
+	    if (!strncmp(line, "model name", 10) && (c = strchr(line, ':'))) {
+		strcpy(cpu, c + 2);
+		cpu[strcspn(cpu, "\n\"")] = 0;
+		break;
+	    }
+	}
+	fclose(info);
+    }
+
+    fprintf(f, "  \"env\": {\"host\": \"%s\", \"os\": \"%s %s\", "
+	    "\"machine\": \"%s\", \"cpu\": \"%s\", \"cpus\": %ld, "
+	    "\"compiler\": \"%s\", \"timer\": \"%s\", \"bench\": %d},\n",
+	    u.nodename, u.sysname, u.release, u.machine, cpu,
+	    sysconf(_SC_NPROCESSORS_ONLN),
+#ifdef __VERSION__
+	    __VERSION__,
+#else
+	    "unknown",
+#endif
+	    USE_FCYC ? "fcyc" : (USE_ITIMER ? "itimer" : "gettod"),
+	    bench_mode);
+}
+
+/* 
+ * write_results - Write the per-trace results for the mm package 
+ */
+static void write_results(char *filename, int n, char **names, stats_t *stats,
+                          double perfindex)
+{
+    FILE *f;
+    int i;
+
+    if ((f = fopen(filename, "w")) == NULL) {
+	sprintf(msg, "Could not open %s for results", filename);
+	unix_error(msg);
+    }
+
+    fprintf(f, "{\n");
+    write_env(f);
+    fprintf(f, "  \"perfidx\": %.0f,\n", perfindex);
+    fprintf(f, "  \"traces\": [\n");
+    for (i = 0; i < n; i++) {
+	fprintf(f, "    {\"name\": \"%s\", \"valid\": %d, \"ops\": %.0f, "
+		"\"secs\": %.9f, \"secs_mad\": %.9f, \"util\": %.6f, "
+		"\"inst_util\": %.6f, \"lat_p50_ns\": %.0f, "
+		"\"lat_p90_ns\": %.0f, \"lat_p99_ns\": %.0f, "
+		"\"lat_max_ns\": %.0f}%s\n",
+		names[i], stats[i].valid, stats[i].ops,
+		stats[i].secs, stats[i].bench.mad, stats[i].util,
+		stats[i].inst_util, stats[i].lat_p50,
+		stats[i].lat_p90, stats[i].lat_p99,
+		stats[i].lat_max, (i < n - 1) ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+}
+
+/* 
+ * json_number - Find "key": <number> in a results line
+ */
+static int json_number(char *line, char *key, double *value)
+{
+    char pattern[MAXLINE], *p;
+
+    sprintf(pattern, "\"%s\":", key);
+    if ((p = strstr(line, pattern)) == NULL)
+	return 0;
+    *value = strtod(p + strlen(pattern), NULL);
+    return 1;
+}
+
+/* 
+ * compare_results - Compare each trace against the baseline line
+ *     with the same name. A trace regresses when its util drops, or
+ *     its time grows, by more than regress_threshold and by more than
+ *     3 scaled MADs of noise as well. Times are only judged when both
+ *     runs come from benchmark mode, since a one-shot time has no MAD
+ *     and routinely moves by more than the threshold on its own.
+ *     Returns the number of regressed traces.
+ */
+static int compare_results(char *filename, int n, char **names, stats_t *stats)
+{
+    FILE *f;
+    char line[MAXLINE], name[MAXLINE], *p;
+    double base_secs, base_mad, base_util, base_bench = 0, noise, dsecs, dutil;
+    int i, found, timed, regressed, count = 0;
+
+    if ((f = fopen(filename, "r")) == NULL) {
+	sprintf(msg, "Could not open baseline %s", filename);
+	unix_error(msg);
+    }
+
+    /* the environment line says whether the baseline used -B */
+    while (fgets(line, MAXLINE, f))
+	if (strstr(line, "\"name\": \"") == NULL
+	    && json_number(line, "bench", &base_bench))
+	    break;
+    timed = bench_mode && base_bench != 0;
+
+    printf("\nComparison against %s (threshold %.1f%%):\n",
+	   filename, regress_threshold * 100);
+    if (!timed)
+	printf("d-secs not judged: both runs need -B for a noise estimate\n");
+    printf("%5s%10s%10s%9s\n", "trace", "d-secs", "d-util", "verdict");
+    for (i = 0; i < n; i++) {
+	found = 0;
+	rewind(f);
+	while (fgets(line, MAXLINE, f)) {
+	    if ((p = strstr(line, "\"name\": \"")) == NULL)
+		continue;
+	    sscanf(p + 9, "%[^\"]", name);
+	    if (!strcmp(name, names[i])
+		&& json_number(line, "secs", &base_secs)
+		&& json_number(line, "util", &base_util)) {
+		if (!json_number(line, "secs_mad", &base_mad))
+		    base_mad = 0;
+		found = 1;
+		break;
+	    }
+	}
+	if (!found || !stats[i].valid) {
+	    printf("%2d%13s%10s%9s\n", i, "-", "-", found ? "invalid" : "new");
+	    count += found;
+	    continue;
+	}
+
+	dsecs = (stats[i].secs - base_secs) / base_secs;
+	dutil = (stats[i].util - base_util) / base_util;
+	noise = 3 * 1.4826 * sqrt(base_mad * base_mad
+				  + stats[i].bench.mad * stats[i].bench.mad);
+	regressed = (timed && dsecs > regress_threshold
+		     && stats[i].secs - base_secs > noise)
+	    || (-dutil > regress_threshold);
+	printf("%2d%12.1f%%%9.1f%%%9s\n", i, dsecs * 100, dutil * 100,
+	       regressed ? "REGRESS" : "ok");
+	count += regressed;
+    }
+
+    fclose(f);
+    return count;
+}
+
+/*
+ * start_chaos - Reset the chaos state and seed random() for a run
+ */
+static void start_chaos(long seed)
+{
+    memset(chaos_state, 0, sizeof(*chaos_state));
+    chaos_state->seed = seed;
+    srandom(seed);
+}
+
+/*
+ * print_chaos_state - Say where a chaos run stopped, and how to replay it
+ */
+static void print_chaos_state(chaos_state_t *s, char *tracefile)
+{
+    printf("      seed %ld, op %d (line %d), mangle %d: offset %lu len %lu value 0x%02x\n",
+	   s->seed, s->op, LINENUM(s->op), s->mangles,
+	   (unsigned long)s->offset, (unsigned long)s->len, s->value);
+    printf("      replay with -f %s%s%s%s -z %ld\n", tracedir, tracefile,
+	   use_realloc ? " -R" : "", use_batch ? " -b" : "", s->seed);
+}
+
+/*
+ * alloc_chaos_states - Map n chaos states that forked workers share
+ *     with the driver
+ */
+static chaos_state_t *alloc_chaos_states(int n)
+{
+    void *p = mmap(NULL, (n + 1) * sizeof(chaos_state_t), PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (p == MAP_FAILED)
+	unix_error("mmap failed for the chaos states");
+    return (chaos_state_t *)p;
+}
+
+/*
+ * wait_job - Wait for one of the first n jobs to exit and return its
+ *     index, or -1 if some other child exited
+ */
+static int wait_job(job_t *jobs, int n, int *status)
+{
+    pid_t pid;
+    int i;
+
+    if ((pid = waitpid(-1, status, 0)) < 0)
+	unix_error("waitpid failed");
+    for (i = 0; i < n; i++)
+	if (jobs[i].pid == pid) {
+	    jobs[i].pid = 0;
+	    return i;
+	}
+    return -1;
+}
+
+/*
+ * start_job - Fork a worker for one job. The worker runs the job
+ *     against its own copy of the heap and writes a job_result_t to
+ *     a pipe; the driver keeps the read end in job->fd.
+ */
+static void start_job(job_t *job, char **tracefiles, int checks)
+{
+    int fds[2];
+    int start_errors;
+    job_result_t r;
+    trace_t *trace;
+    range_t *ranges = NULL;
+
+    if (pipe(fds) < 0)
+	unix_error("pipe failed in start_job");
+    fflush(stdout);
+    if ((job->pid = fork()) < 0)
+	unix_error("fork failed in start_job");
+
+    if (job->pid > 0) {
+	close(fds[1]);
+	job->fd = fds[0];
+	return;
+    }
+
+    /* Worker: keep off the CPU reserved for the speed runs */
+    close(fds[0]);
+    if (pin_cpu >= 0)
+	(void)bench_avoid_cpu(pin_cpu);
+
+    memset(&r, 0, sizeof(r));
+    start_errors = errors;
+    trace = read_trace(tracedir, tracefiles[job->trace], job->trace);
+    r.stats.ops = trace->num_ops;
+    if (job->chaos) {
+	chaos_state = job->state;
+	start_chaos(job->seed);
+	(void)eval_mm_valid(trace, job->trace, &ranges, checks, 1);
+    } else {
+	r.stats.valid = eval_mm_valid(trace, job->trace, &ranges, checks, 0);
+	if (r.stats.valid)
+	    r.stats.util = eval_mm_util(trace, job->trace, &ranges, &r.stats);
+    }
+    r.errors = errors - start_errors;
+
+    fflush(stdout);
+    if (write(fds[1], &r, sizeof(r)) != sizeof(r))
+	_exit(1);
+    _exit(0);
+}
+
+/*
+ * finish_job - Collect the result of a worker that has exited and
+ *     return JOB_OK or the way it failed. A worker that died without
+ *     reporting makes its trace invalid unless it was a chaos repeat.
+ *     Failures are counted in errors and printed only if report is set.
+ */
+static int finish_job(job_t *job, int status, char **tracefiles,
+		      stats_t *stats, int report)
+{
+    job_result_t r;
+    ssize_t n = read(job->fd, &r, sizeof(r));
+    int result = JOB_OK;
+
+    close(job->fd);
+    if (n != sizeof(r)) {
+	if (WIFSIGNALED(status))
+	    sprintf(msg, "%s worker killed by signal %d",
+		    job->chaos ? "chaos" : "correctness", WTERMSIG(status));
+	else
+	    sprintf(msg, "%s worker exited with status %d",
+		    job->chaos ? "chaos" : "correctness", WEXITSTATUS(status));
+	if (!job->chaos)
+	    stats[job->trace].valid = 0;
+	result = JOB_CRASHED;
+    } else if (job->chaos && job->state->false_check) {
+	sprintf(msg, "mm_check failed before any mangle changed the heap");
+	result = JOB_FALSE_CHECK;
+    } else if (job->chaos && r.errors > 0) {
+	sprintf(msg, "%d errors after corruption that mm_check missed", r.errors);
+	result = JOB_ERRORS;
+    }
+
+    if (!job->chaos && n == sizeof(r)) {
+	stats[job->trace] = r.stats;
+	errors += r.errors;
+    }
+    if (result != JOB_OK) {
+	errors++;
+	if (report) {
+	    printf("ERROR [trace %d]: %s\n", job->trace, msg);
+	    if (job->chaos)
+		print_chaos_state(job->state, tracefiles[job->trace]);
+	}
+    }
+    return result;
+}
+
+/*
+ * run_jobs - Run the correctness, defensiveness and util phases of
+ *     every trace in up to njobs forked workers at a time, filling in
+ *     stats. Since mm.c and memlib are process-global, each worker gets
+ *     its own heap. The chaos repeats for a trace are queued as
+ *     separate workers once the trace is known to be valid; their seeds
+ *     are drawn here, in trace order, so a given -s gives the same
+ *     chaos however the workers are scheduled. Speed runs are left to
+ *     the caller so they are not disturbed by the workers.
+ */
+static void run_jobs(int njobs, char **tracefiles, int num_tracefiles,
+                     int checks, int repeats, stats_t *stats)
+{
+    int i, j, t, status;
+    int nchaos = (checks && repeats > 0) ? repeats : 0;
+    int total = num_tracefiles * (1 + nchaos);
+    int queued = 0, next = 0, running = 0;
+    long *seeds;
+    job_t *jobs;
+    chaos_state_t *states;
+
+    jobs = (job_t *)calloc(total, sizeof(job_t));
+    seeds = (long *)malloc((num_tracefiles * nchaos + 1) * sizeof(long));
+    if (jobs == NULL || seeds == NULL)
+	unix_error("malloc failed in run_jobs");
+    states = alloc_chaos_states(num_tracefiles * nchaos);
+    for (i = 0; i < num_tracefiles * nchaos; i++)
+	seeds[i] = random();
+
+    for (i = 0; i < num_tracefiles; i++) {
+	jobs[queued].trace = i;
+	jobs[queued].pid = 0;
+	queued++;
+    }
+
+    if (verbose > 1)
+	printf("Checking mm_malloc in %d workers\n", njobs);
+
+    while (next < queued || running > 0) {
+	while (next < queued && running < njobs) {
+	    start_job(&jobs[next++], tracefiles, checks);
+	    running++;
+	}
+
+	if ((i = wait_job(jobs, next, &status)) < 0)
+	    continue;
+	running--;
+	(void)finish_job(&jobs[i], status, tracefiles, stats, 1);
+
+	/* A valid trace earns its chaos repeats */
+	t = jobs[i].trace;
+	if (!jobs[i].chaos && stats[t].valid) {
+	    for (j = 0; j < nchaos; j++) {
+		jobs[queued].trace = t;
+		jobs[queued].chaos = 1;
+		jobs[queued].seed = seeds[t * nchaos + j];
+		jobs[queued].state = &states[t * nchaos + j];
+		queued++;
+	    }
+	}
+    }
+
+    munmap(states, (num_tracefiles * nchaos + 1) * sizeof(chaos_state_t));
+    free(seeds);
+    free(jobs);
+}
+
+/*
+ * run_fuzz - Run iters seeded chaos runs, spread over the traces that
+ *     pass the correctness check, in up to njobs forked workers at a
+ *     time. A run fails if its worker crashes or if mm_check rejects a
+ *     heap that no mangle has actually changed yet. Failures are
+ *     reported with their seed, op and mangle, and can be replayed one
+ *     at a time with -z. Returns the number of failures.
+ */
+static int run_fuzz(int njobs, int iters, char **tracefiles, int num_tracefiles)
+{
+    int i, n, status, running = 0, next = 0;
+    int crashes = 0, false_checks = 0, missed = 0, failures = 0;
+    int *valid;
+    job_t *jobs;
+    chaos_state_t *states;
+    stats_t *stats;
+    trace_t *trace;
+    range_t *ranges = NULL;
+
+    /* Only fuzz traces that the allocator handles when left alone */
+    valid = (int *)malloc(num_tracefiles * sizeof(int));
+    jobs = (job_t *)calloc(iters, sizeof(job_t));
+    stats = (stats_t *)calloc(num_tracefiles, sizeof(stats_t));
+    if (valid == NULL || jobs == NULL || stats == NULL)
+	unix_error("malloc failed in run_fuzz");
+    mem_init();
+    for (i = n = 0; i < num_tracefiles; i++) {
+	trace = read_trace(tracedir, tracefiles[i], i);
+	if (eval_mm_valid(trace, i, &ranges, 1, 0))
+	    valid[n++] = i;
+	free_trace(trace);
+    }
+    clear_ranges(&ranges);
+    if (n == 0) {
+	printf("No valid traces to fuzz\n");
+	return 1;
+    }
+
+    states = alloc_chaos_states(iters);
+    for (i = 0; i < iters; i++) {
+	jobs[i].trace = valid[i % n];
+	jobs[i].chaos = 1;
+	jobs[i].seed = random();
+	jobs[i].state = &states[i];
+    }
+
+    printf("Fuzzing %d traces with %d chaos runs in %d workers\n", n, iters, njobs);
+    fflush(stdout);
+    verbose = 0;
+    report_errors = 0;
+    while (next < iters || running > 0) {
+	while (next < iters && running < njobs) {
+	    start_job(&jobs[next++], tracefiles, 1);
+	    running++;
+	}
+	if ((i = wait_job(jobs, next, &status)) < 0)
+	    continue;
+	running--;
+	switch (finish_job(&jobs[i], status, tracefiles, stats,
+			   failures < FUZZ_MAX_REPORTS)) {
+	case JOB_CRASHED:
+	    crashes++;
+	    break;
+	case JOB_FALSE_CHECK:
+	    false_checks++;
+	    break;
+	case JOB_ERRORS:
+	    missed++;
+	    break;
+	default:
+	    continue;
+	}
+	failures++;
+    }
+
+    if (failures > FUZZ_MAX_REPORTS)
+	printf("... %d more failures not shown\n", failures - FUZZ_MAX_REPORTS);
+    printf("%d chaos runs: %d crashed, %d false mm_check failures, %d missed corruptions\n",
+	   iters, crashes, false_checks, missed);
+
+    munmap(states, (iters + 1) * sizeof(chaos_state_t));
+    free(stats);
+    free(jobs);
+    free(valid);
+    return failures;
+}
+
+/*
+ * replay_chaos - Rerun the chaos run started from seed on each trace,
+ *     in this process so that a crash can be caught in a debugger, and
+ *     say where it stopped. Returns nonzero if mm_check rejected a heap
+ *     that no mangle had changed, or let a corruption through.
+ */
+static int replay_chaos(long seed, char **tracefiles, int num_tracefiles)
+{
+    int i, start_errors, result = 0;
+    trace_t *trace;
+    range_t *ranges = NULL;
+
+    mem_init();
+    for (i = 0; i < num_tracefiles; i++) {
+	trace = read_trace(tracedir, tracefiles[i], i);
+	printf("Replaying chaos seed %ld on %s\n", seed, tracefiles[i]);
+	fflush(stdout);
+	start_chaos(seed);
+	start_errors = errors;
+	if (eval_mm_valid(trace, i, &ranges, 1, 1))
+	    printf("  completed all %d ops\n", trace->num_ops);
+	else if (chaos_state->false_check) {
+	    printf("  mm_check failed before any mangle changed the heap\n");
+	    result = 1;
+	} else if (errors > start_errors) {
+	    printf("  mm_check missed the corruption\n");
+	    result = 1;
+	} else
+	    printf("  corruption caught\n");
+	print_chaos_state(chaos_state, tracefiles[i]);
+	free_trace(trace);
+    }
+    clear_ranges(&ranges);
+    return result;
+}
+
+/*************************************
+ * Some miscellaneous helper routines
+ ************************************/
+
+static int check(int chaos, const char *what)
+{
+  if (chaos) {
+    mangle();
+    if (!mm_check()) {
+      if (!chaos_state->changed)
+        chaos_state->false_check = 1;
+      mem_reset();
+      return 0;
+    }
+  } else {
+    if (!mm_check()) {
+      if (!strcmp(what, "alloc"))
+        app_error("mm_check failed after alloc");
+      else
+        app_error("mm_check failed after free");
+    }
+  }
+
+  return 1;
+}
+
+static int check_free(int chaos, void *p)
+{  
+  if (chaos) {
+    if (!mm_can_free(p)) {
+      mem_reset();
+      return 0;
+    }
+    if (mm_can_free(p + 8))
+      mm_free(p+8);
+    if (mm_can_free(p - 8))
+      mm_free(p-8);
+  } else {
+    if (!mm_can_free(p)) {
+      app_error("mm_can_free incorrectly claimed unfreeable");
+    }
+  }
+
+  return 1;
+}
+
+static void check_post_free(int chaos, void *p)
 {
   if (chaos) {
     if (mm_can_free(p)) {
@@ -1025,7 +2453,115 @@ static void check_post_free(int chaos, void *p)
   } else {
     if (mm_can_free(p))
       app_error("mm_can_free incorrectly claimed freeable after free");
+    if (mm_block_lookup(p) == p)
+      app_error("mm_block_lookup found a block after free");
+  }
+}
+
+/*
+ * mm_alloc_op, libc_alloc_op - Allocate the block for an ALLOC op, with
+ *     memalign if the op has an alignment and calloc if it has an
+ *     element count
+ */
+static char *mm_alloc_op(traceop_t *op)
+{
+    if (op->nmemb)
+        return mm_calloc(op->nmemb, op->size / op->nmemb);
+    return op->align ? mm_memalign(op->align, op->size) : mm_malloc(op->size);
+}
+
+static char *libc_alloc_op(traceop_t *op)
+{
+    void *p;
+
+    if (op->nmemb)
+        return calloc(op->nmemb, op->size / op->nmemb);
+    if (!op->align)
+        return malloc(op->size);
+    /* posix_memalign wants at least pointer alignment */
+    if (posix_memalign(&p, op->align < sizeof(void *) ? sizeof(void *) : op->align,
+                       op->size) != 0)
+        return NULL;
+    return p;
+}
+
+/*
+ * batch_alloc - The block for the ALLOC at op i. The first op of a run
+ *     of ALLOCs of the same size gets blocks for the whole run (up to
+ *     BATCH_MAX) from one mm_malloc_batch call; the rest of the run
+ *     just picks theirs up.
+ */
+static char *batch_alloc(trace_t *trace, int i)
+{
+    int n, size = trace->ops[i].size;
+
+    if (i > batch_op && i < batch_op + batch_len)
+        return batch_blocks[i - batch_op];
+    if (trace->ops[i].align || trace->ops[i].nmemb)
+        return mm_alloc_op(&trace->ops[i]);
+    for (n = 1; n < BATCH_MAX && i + n < trace->num_ops; n++)
+        if (trace->ops[i+n].type != ALLOC || trace->ops[i+n].size != size
+            || trace->ops[i+n].align || trace->ops[i+n].nmemb)
+            break;
+    batch_op = i;
+    batch_len = mm_malloc_batch(size, n, batch_blocks);
+    return batch_len ? batch_blocks[0] : NULL;
+}
+
+/*
+ * batch_frees - Collect the blocks of the run of FREEs (up to
+ *     BATCH_MAX) starting at op i into ptrs, and return how many.
+ */
+static int batch_frees(trace_t *trace, int i, void **ptrs)
+{
+    int n;
+
+    for (n = 0; n < BATCH_MAX && i + n < trace->num_ops; n++) {
+        if (trace->ops[i+n].type != FREE)
+            break;
+        ptrs[n] = trace->blocks[trace->ops[i+n].index];
+    }
+    return n;
+}
+
+/*
+ * check_lookup - mm_block_lookup must map the first and last byte of a
+ *     new block back to it. Under chaos it only has to not crash.
+ */
+static void check_lookup(int chaos, char *p, int size)
+{
+  if (chaos) {
+    mm_block_lookup(p + size/2);
+    mm_block_lookup(p - 8);
+  } else {
+    if (mm_block_lookup(p) != p || mm_block_lookup(p + size - 1) != p)
+      app_error("mm_block_lookup did not find a new block");
+    if (mm_block_lookup(p - 1) == p)
+      app_error("mm_block_lookup found a block before its start");
+  }
+}
+
+/*
+ * usable_size - How much of new block p, allocated with size bytes, the
+ *     caller may write: all of mm_usable_size, which must cover the
+ *     request. Chaos may have scribbled on the header, so chaos runs
+ *     stick to the request. Returns 0 after reporting an error.
+ */
+static int usable_size(int chaos, char *p, int size, int tracenum, int opnum)
+{
+  size_t usable;
+  char msg[MAXLINE];
+
+  if (chaos)
+    return size;
+  usable = mm_usable_size(p);
+  if (usable < size) {
+    sprintf(msg, "mm_usable_size says %lu bytes for a %d-byte block",
+            (unsigned long)usable, size);
+    malloc_error(tracenum, opnum, msg);
+    return 0;
   }
+  return usable;
 }
 
 static int mangle_pageno;
@@ -1039,6 +2575,8 @@ static void mangle_page(void *addr) {
     size_t c = mangle_offset;
     
     while (len--) {
+      if (((char *)addr)[c] != mangle_v)
+        chaos_state->changed = 1;
       ((char *)addr)[c++] = mangle_v;
     }
 
@@ -1056,6 +2594,11 @@ static void mangle(void)
     mangle_len = mem_pagesize() - mangle_offset;  
   mangle_v = random() % 256;
 
+  chaos_state->mangles++;
+  chaos_state->offset = mangle_offset;
+  chaos_state->len = mangle_len;
+  chaos_state->value = (unsigned char)mangle_v;
+
   mangle_pageno = random() % 16;
   pagemap_for_each(mangle_page, 0);
 }
@@ -1122,6 +2665,344 @@ static void printresults(int n, stats_t *stats)
 
 }
 
+/*
+ * printhugeresults - prints the 4KB vs huge-page chunk comparison
+ */
+static void printhugeresults(int n, stats_t *stats)
+{
+    int i;
+
+    printf("%5s%12s%12s%10s%10s\n",
+	   "trace", "dTLB-4K", "dTLB-huge", "secs-4K", "secs-huge");
+    for (i=0; i < n; i++) {
+	if (!stats[i].valid) {
+	    printf("%2d%15s%12s%10s%10s\n", i, "-", "-", "-", "-");
+	    continue;
+	}
+	if (stats[i].dtlb >= 0 && stats[i].dtlb_huge >= 0)
+	    printf("%2d%15.0f%12.0f", i, stats[i].dtlb, stats[i].dtlb_huge);
+	else
+	    printf("%2d%15s%12s", i, "n/a", "n/a");
+	printf("%10.6f%10.6f\n", stats[i].secs, stats[i].secs_huge);
+    }
+}
+
+/*
+ * printsizedresults - prints the mm_free vs mm_free_sized comparison,
+ *     with the time saved per free
+ */
+static void printsizedresults(int n, stats_t *stats)
+{
+    int i;
+
+    printf("%5s%10s%10s%12s%12s\n",
+	   "trace", "frees", "secs", "secs-sized", "ns/free");
+    for (i=0; i < n; i++) {
+	if (!stats[i].valid) {
+	    printf("%2d%13s%10s%12s%12s\n", i, "-", "-", "-", "-");
+	    continue;
+	}
+	printf("%2d%13.0f%10.6f%12.6f", i, stats[i].frees, stats[i].secs,
+	       stats[i].secs_sized);
+	if (stats[i].frees > 0)
+	    printf("%12.1f\n",
+		   (stats[i].secs - stats[i].secs_sized) * 1e9 / stats[i].frees);
+	else
+	    printf("%12s\n", "-");
+    }
+}
+
+/*
+ * printlocalityresults - prints the simulated TLB and cache miss rates
+ *     and how often an alloc lands on the page of the one before it,
+ *     with local placement next to first fit
+ */
+static void printlocalityresults(int n, stats_t *stats)
+{
+    int i;
+    locality_t *l, *f;
+    locality_t sum, sum_ff;
+
+    memset(&sum, 0, sizeof(sum));
+    memset(&sum_ff, 0, sizeof(sum_ff));
+    printf("%5s%7s%9s%7s%9s%7s%9s\n",
+	   "trace", "tlb", "tlb-ff", "line", "line-ff", "same", "same-ff");
+    for (i=0; i < n; i++) {
+	l = &stats[i].loc;
+	f = &stats[i].loc_ff;
+	if (!stats[i].valid) {
+	    printf("%2d%10s%9s%7s%9s%7s%9s\n", i, "-", "-", "-", "-", "-", "-");
+	    continue;
+	}
+	printf("%2d%9.1f%%%8.1f%%%6.1f%%%8.1f%%%6.0f%%%8.0f%%\n", i,
+	       100.0 * l->tlb_misses / l->touches, 100.0 * f->tlb_misses / f->touches,
+	       100.0 * l->line_misses / l->touches, 100.0 * f->line_misses / f->touches,
+	       100.0 * l->same_page / l->allocs, 100.0 * f->same_page / f->allocs);
+	sum.touches += l->touches;
+	sum.tlb_misses += l->tlb_misses;
+	sum.line_misses += l->line_misses;
+	sum.allocs += l->allocs;
+	sum.same_page += l->same_page;
+	sum_ff.touches += f->touches;
+	sum_ff.tlb_misses += f->tlb_misses;
+	sum_ff.line_misses += f->line_misses;
+	sum_ff.allocs += f->allocs;
+	sum_ff.same_page += f->same_page;
+    }
+    printf("%-5s%6.1f%%%8.1f%%%6.1f%%%8.1f%%%6.0f%%%8.0f%%\n", "Total",
+	   100.0 * sum.tlb_misses / (sum.touches ? sum.touches : 1),
+	   100.0 * sum_ff.tlb_misses / (sum_ff.touches ? sum_ff.touches : 1),
+	   100.0 * sum.line_misses / (sum.touches ? sum.touches : 1),
+	   100.0 * sum_ff.line_misses / (sum_ff.touches ? sum_ff.touches : 1),
+	   100.0 * sum.same_page / (sum.allocs ? sum.allocs : 1),
+	   100.0 * sum_ff.same_page / (sum_ff.allocs ? sum_ff.allocs : 1));
+}
+
+/*
+ * printorderresults - prints util, inst_util and throughput with the
+ *     LIFO free list next to those with the address-ordered one
+ */
+static void printorderresults(int n, stats_t *stats)
+{
+    int i;
+    double util = 0, util_ao = 0, inst = 0, inst_ao = 0;
+    double ops = 0, secs = 0, secs_ao = 0;
+
+    printf("%5s%7s%9s%7s%9s%8s%10s\n",
+	   "trace", "util", "util-ao", "inst", "inst-ao", "Kops", "Kops-ao");
+    for (i=0; i < n; i++) {
+	if (!stats[i].valid || !stats[i].valid_ao) {
+	    printf("%2d%10s%9s%7s%9s%8s%10s\n", i, "-", "-", "-", "-", "-", "-");
+	    continue;
+	}
+	printf("%2d%9.0f%%%8.0f%%%6.0f%%%8.0f%%%8.0f%10.0f\n", i,
+	       stats[i].util*100.0, stats[i].util_ao*100.0,
+	       stats[i].inst_util*100.0, stats[i].inst_util_ao*100.0,
+	       stats[i].ops/1e3/stats[i].secs, stats[i].ops/1e3/stats[i].secs_ao);
+	util += stats[i].util;
+	util_ao += stats[i].util_ao;
+	inst += stats[i].inst_util;
+	inst_ao += stats[i].inst_util_ao;
+	ops += stats[i].ops;
+	secs += stats[i].secs;
+	secs_ao += stats[i].secs_ao;
+    }
+    printf("%-5s%6.0f%%%8.0f%%%6.0f%%%8.0f%%%8.0f%10.0f\n", "Total",
+	   util*100.0/n, util_ao*100.0/n, inst*100.0/n, inst_ao*100.0/n,
+	   ops/1e3/(secs ? secs : 1), ops/1e3/(secs_ao ? secs_ao : 1));
+}
+
+/*
+ * time_speed - Time one of the xxx_speed routines, with the K-best
+ *     (or other config.h) scheme by default and with repeated runs
+ *     and summary statistics in benchmark mode
+ */
+static double time_speed(fsecs_test_funct f, speed_t *params, stats_t *stats)
+{
+    if (!bench_mode)
+	return fsecs(f, params);
+    bench(f, params, &stats->bench);
+    return stats->bench.median;
+}
+
+/*
+ * count_speed - Count hardware events for one run of an xxx_speed routine
+ */
+static void count_speed(fsecs_test_funct f, speed_t *params, stats_t *stats)
+{
+    long long counts[PERFCTR_NUM_EVENTS];
+    int e;
+
+    perfctr_measure(f, params, counts);
+    for (e = 0; e < PERFCTR_NUM_EVENTS; e++)
+	stats->counters[e] = counts[e];
+}
+
+/*
+ * printcounterresults - prints IPC and hardware events per op
+ */
+static void printcounterresults(int n, stats_t *stats)
+{
+    static const int per_op[] = { PERFCTR_CYCLES, PERFCTR_L1D_MISSES,
+				  PERFCTR_LLC_MISSES, PERFCTR_DTLB_MISSES,
+				  PERFCTR_BRANCH_MISSES };
+    int i, e, k = sizeof(per_op) / sizeof(per_op[0]);
+    double *c;
+
+    printf("%5s%7s", "trace", "IPC");
+    for (e = 0; e < k; e++)
+	printf("%14s", perfctr_name(per_op[e]));
+    printf("   (per op)\n");
+    for (i=0; i < n; i++) {
+	c = stats[i].counters;
+	printf("%2d", i);
+	if (!stats[i].valid) {
+	    printf("%10s\n", "-");
+	    continue;
+	}
+	if (c[PERFCTR_CYCLES] > 0 && c[PERFCTR_INSTRUCTIONS] >= 0)
+	    printf("%10.2f", c[PERFCTR_INSTRUCTIONS] / c[PERFCTR_CYCLES]);
+	else
+	    printf("%10s", "n/a");
+	for (e = 0; e < k; e++) {
+	    if (c[per_op[e]] >= 0)
+		printf("%14.2f", c[per_op[e]] / stats[i].ops);
+	    else
+		printf("%14s", "n/a");
+	}
+	printf("\n");
+    }
+}
+
+/*
+ * printbenchresults - prints the spread of the benchmark-mode timings
+ */
+static void printbenchresults(int n, stats_t *stats)
+{
+    int i;
+
+    printf("%5s%12s%10s%23s%6s\n",
+	   "trace", "median(ms)", "MAD(ms)", "95% CI(ms)", "kept");
+    for (i=0; i < n; i++) {
+	if (!stats[i].valid) {
+	    printf("%2d%15s%10s%23s%6s\n", i, "-", "-", "-", "-");
+	    continue;
+	}
+	printf("%2d%15.4f%10.4f%11.4f -%10.4f%3d/%-2d\n", i,
+	       stats[i].bench.median*1e3,
+	       stats[i].bench.mad*1e3,
+	       stats[i].bench.ci_lo*1e3,
+	       stats[i].bench.ci_hi*1e3,
+	       stats[i].bench.n,
+	       stats[i].bench.n + stats[i].bench.rejected);
+    }
+}
+
+/*
+ * printmemresults - prints peak heap and resident memory use
+ */
+static void printmemresults(int n, stats_t *stats)
+{
+    int i;
+
+    printf("%5s%7s%11s%11s%11s",
+	   "trace", "util", "heap-peak", "res-peak", "res-avg");
+    if (rss_interval > 0)
+	printf("%11s%11s%9s%7s", "rss-peak", "rss-avg", "faults", "util_r");
+    printf("\n");
+    for (i=0; i < n; i++) {
+	if (!stats[i].valid) {
+	    printf("%2d%10s%11s%11s%11s\n", i, "-", "-", "-", "-");
+	    continue;
+	}
+	printf("%2d%9.0f%%%11.0f%11.0f%11.0f", i,
+	       stats[i].util*100.0,
+	       stats[i].heap_peak/1024,
+	       stats[i].res_peak/1024,
+	       stats[i].res_avg/1024);
+	if (rss_interval > 0)
+	    printf("%11.0f%11.0f%9.0f%6.0f%%", 
+		   stats[i].rss_peak/1024,
+		   stats[i].rss_avg/1024,
+		   stats[i].faults,
+		   stats[i].res_util*100.0);
+	printf("\n");
+    }
+}
+
+/*
+ * printreallocresults - prints how mm_realloc moved payload bytes
+ */
+static void printreallocresults(int n, stats_t *stats)
+{
+    int i;
+    double copied = 0, remapped = 0;
+
+    printf("%5s%14s%14s%9s\n", "trace", "copied", "remapped", "avoided");
+    for (i=0; i < n; i++) {
+	if (!stats[i].valid) {
+	    printf("%2d%17s%14s%9s\n", i, "-", "-", "-");
+	    continue;
+	}
+	printf("%2d%17.0f%14.0f%8.0f%%\n", i,
+	       stats[i].realloc_copied,
+	       stats[i].realloc_remapped,
+	       100.0 * stats[i].realloc_remapped
+	       / (stats[i].realloc_copied + stats[i].realloc_remapped + 1));
+	copied += stats[i].realloc_copied;
+	remapped += stats[i].realloc_remapped;
+    }
+    printf("%12s%7.0f%14.0f%8.0f%%\n", "Total       ", copied, remapped,
+	   100.0 * remapped / (copied + remapped + 1));
+}
+
+/*
+ * printslackresults - prints how many bytes past the request
+ *     mm_usable_size gave each alloc on average
+ */
+static void printslackresults(int n, stats_t *stats)
+{
+    int i;
+    double allocs = 0, slack = 0, requested = 0;
+
+    printf("%5s%10s%10s%9s\n", "trace", "allocs", "slack/op", "slack%");
+    for (i=0; i < n; i++) {
+	if (!stats[i].valid) {
+	    printf("%2d%13s%10s%9s\n", i, "-", "-", "-");
+	    continue;
+	}
+	printf("%2d%13.0f%10.1f%8.1f%%\n", i, stats[i].allocs,
+	       stats[i].slack / (stats[i].allocs ? stats[i].allocs : 1),
+	       100.0 * stats[i].slack / (stats[i].requested ? stats[i].requested : 1));
+	allocs += stats[i].allocs;
+	requested += stats[i].requested;
+	slack += stats[i].slack;
+    }
+    printf("%12s%3.0f%10.1f%8.1f%%\n", "Total       ", allocs,
+	   slack / (allocs ? allocs : 1),
+	   100.0 * slack / (requested ? requested : 1));
+}
+
+/*
+ * printallocresults - prints the free-list counters mm.c keeps when
+ *     it is built with MM_STATS=1
+ */
+static void printallocresults(int n, stats_t *stats)
+{
+    int i;
+    mm_stats_t *a;
+
+    printf("%5s%9s%9s%8s%6s%7s%8s%8s%8s%8s%8s%5s%5s%10s%8s%7s%8s%7s\n", "trace",
+	   "mallocs", "visit/op", "maxvis", "hit%", "fails", "splits",
+	   "coal1", "coal2", "coal3", "coal4", "ext", "grow", "mappedKB",
+	   "qhits", "qflush", "bumps", "clear%");
+    for (i=0; i < n; i++) {
+	a = &stats[i].alloc;
+	if (!stats[i].valid || !stats[i].have_alloc) {
+	    printf("%2d%12s\n", i, "-");
+	    continue;
+	}
+	printf("%2d%12lu%9.1f%8lu%5.0f%%%7lu%8lu%8lu%8lu%8lu%8lu%5lu%5lu%10lu%8lu%7lu%8lu", i,
+	       (unsigned long)a->mallocs,
+	       (double)a->nodes_visited / (a->mallocs ? a->mallocs : 1),
+	       (unsigned long)a->max_visited,
+	       100.0 * a->bin_hits / (a->mallocs ? a->mallocs : 1),
+	       (unsigned long)a->failed_fits,
+	       (unsigned long)a->splits,
+	       (unsigned long)a->coalesce[0], (unsigned long)a->coalesce[1],
+	       (unsigned long)a->coalesce[2], (unsigned long)a->coalesce[3],
+	       (unsigned long)a->extends, (unsigned long)a->grows,
+	       (unsigned long)(a->bytes_mapped / 1024),
+	       (unsigned long)a->quick_hits, (unsigned long)a->quick_flushes,
+	       (unsigned long)a->bumps);
+	/* share of calloc bytes that had to be memset */
+	if (a->calloc_bytes)
+	    printf("%6.0f%%\n", 100.0 * a->calloc_cleared / a->calloc_bytes);
+	else
+	    printf("%7s\n", "-");
+    }
+}
+
 /* 
  * app_error - Report an arbitrary application error
  */
@@ -1146,7 +3027,8 @@ void unix_error(char *msg)
 void malloc_error(int tracenum, int opnum, char *msg)
 {
     errors++;
-    printf("ERROR [trace %d, line %d]: %s\n", tracenum, LINENUM(opnum), msg);
+    if (report_errors)
+	printf("ERROR [trace %d, line %d]: %s\n", tracenum, LINENUM(opnum), msg);
 }
 
 /* 
@@ -1154,7 +3036,10 @@ void malloc_error(int tracenum, int opnum, char *msg)
  */
 static void usage(void) 
 {
-    fprintf(stderr, "Usage: mdriver [-nhvVal] [-f <file>] [-t <dir>] [-s <seed>] [-r <reps>]\n");
+    fprintf(stderr, "Usage: mdriver [-nhvValbAHLRmPSU] [-f <file>] [-t <dir>] [-s <seed>] [-r <reps>]\n");
+    fprintf(stderr, "               [-i <ops>] [-T <file>] [-d <n>] [-B <reps>] [-w <n>] [-p <cpu>]\n");
+    fprintf(stderr, "               [-o <file>] [-c <file>] [-x <pct>] [-j <n>]\n");
+    fprintf(stderr, "               [-F <runs>] [-z <seed>]\n");
     fprintf(stderr, "Options\n");
     fprintf(stderr, "\t-n         Skip mm_check and mm_can_free correctness.\n");
     fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
@@ -1165,4 +3050,33 @@ static void usage(void)
     fprintf(stderr, "\t-l         Run libc malloc as well.\n");
     fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
     fprintf(stderr, "\t-q         Quiet: not per-trace performance breakdowns.\n");
+    fprintf(stderr, "\t-H         Compare dTLB misses with huge-page chunks.\n");
+    fprintf(stderr, "\t-P         Count cycles, instructions, cache, TLB and branch\n");
+    fprintf(stderr, "\t           misses per op with perf_event_open.\n");
+    fprintf(stderr, "\t-R         Use mm_realloc for realloc requests.\n");
+    fprintf(stderr, "\t-S         Free with mm_free_sized, and time it against mm_free.\n");
+    fprintf(stderr, "\t-A         Compare LIFO and address-ordered free lists.\n");
+    fprintf(stderr, "\t-L         Compare TLB and cache misses, simulated, with local\n");
+    fprintf(stderr, "\t           placement and with first fit.\n");
+    fprintf(stderr, "\t-b         Replay runs of same-size allocs and of frees with\n");
+    fprintf(stderr, "\t           mm_malloc_batch and mm_free_batch.\n");
+    fprintf(stderr, "\t-m         Print peak and average resident memory.\n");
+    fprintf(stderr, "\t-U         Print the average usable bytes past each request.\n");
+    fprintf(stderr, "\t-i <ops>   Also sample real RSS and faults every <ops> ops.\n");
+    fprintf(stderr, "\t-T <file>  Write live/heap bytes and free blocks per op to\n");
+    fprintf(stderr, "\t           <file> (CSV, or binary if it ends in .bin).\n");
+    fprintf(stderr, "\t-d <n>     Keep one -T sample every <n> ops.\n");
+    fprintf(stderr, "\t-B <reps>  Benchmark: time <reps> runs per trace, report median,\n");
+    fprintf(stderr, "\t           MAD and 95%% CI, and rate against libc measured live.\n");
+    fprintf(stderr, "\t-w <n>     Untimed warmup runs per trace with -B.\n");
+    fprintf(stderr, "\t-p <cpu>   Pin the driver to <cpu>.\n");
+    fprintf(stderr, "\t-o <file>  Write per-trace results and environment as JSON.\n");
+    fprintf(stderr, "\t-c <file>  Compare against a baseline written by -o; exit 2\n");
+    fprintf(stderr, "\t           if any trace regresses.\n");
+    fprintf(stderr, "\t-x <pct>   Regression threshold for -c (default 5).\n");
+    fprintf(stderr, "\t-j <n>     Run the correctness, chaos and util phases in up to\n");
+    fprintf(stderr, "\t           <n> forked workers; speed runs stay serial.\n");
+    fprintf(stderr, "\t-F <runs>  Fuzz mm_check and mm_can_free with <runs> seeded chaos\n");
+    fprintf(stderr, "\t           runs in parallel workers (-j, default one per CPU).\n");
+    fprintf(stderr, "\t-z <seed>  Replay the chaos run started from <seed>.\n");
 }
@@ -1,6 +1,7 @@
 /*
  * memlib.c - bridge to mmap
  */
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -9,14 +10,27 @@
 #include <string.h>
 #include <inttypes.h>
 #include <errno.h>
+#include <stddef.h>
 
 #include "memlib.h"
 #include "pagemap.h"
 
+static int check_thp(void);
+static void record_pages(void *p, size_t sz, int flags);
+static void forget_pages(void *p, size_t sz);
+
 /* private variables */
 static int activity_counter = 0; /* to simulate other processes */
 
 static int page_count;
+static int purged_count; /* mapped pages handed back with mem_purge */
+
+static int huge_enabled = 0; /* set by mem_set_huge */
+static int thp_usable = 1;   /* transparent huge pages not set to "never" */
+static int hugetlb_usable = 1; /* cleared after the first MAP_HUGETLB failure */
+
+static char *room_start = NULL; /* address space reserved by mem_map_room */
+static char *room_end = NULL;
 
 /* 
  * mem_init - initialize the memory system model
@@ -29,11 +43,40 @@ void mem_init(void)
             page_size);
     abort();
   }
+
+  thp_usable = check_thp();
+}
+
+/*
+ * check_thp - transparent huge pages are of no use when the system
+ *             setting is "never"
+ */
+static int check_thp(void)
+{
+  char buf[128];
+  FILE *f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+  int usable = 0;
+
+  if (f) {
+    if (fgets(buf, sizeof(buf), f))
+      usable = (strstr(buf, "[never]") == NULL);
+    fclose(f);
+  }
+  return usable;
 }
 
 static void unmap(void *p)
 {
-  if (munmap(p, APAGE_SIZE) < 0) {
+  size_t sz = APAGE_SIZE;
+
+  if (pagemap_flags(p) & PAGEMAP_HUGETLB) {
+    /* a hugetlb page can only be unmapped as a whole */
+    if (((uintptr_t)p) & (HPAGE_SIZE - 1))
+      return;
+    sz = HPAGE_SIZE;
+  }
+
+  if (munmap(p, sz) < 0) {
     fprintf(stderr, "unexpected error in munmap: %s (%d)\n",
             strerror(errno), errno);
     abort();
@@ -46,10 +89,45 @@ static void unmap(void *p)
 void mem_reset(void)
 {
   pagemap_for_each(unmap, 1);
+  mem_release_room();
   page_count = 0;
+  purged_count = 0;
   activity_counter = 0;
 }
 
+/*
+ * mem_set_huge - enable or disable huge-page backed mappings from
+ *                mem_map_huge(); disabled by default
+ */
+void mem_set_huge(int enable)
+{
+  huge_enabled = enable;
+}
+
+/*
+ * mem_hugepagesize - returns the size that mem_map_huge() aligns to,
+ *                    or 0 when huge mappings are disabled
+ */
+size_t mem_hugepagesize(void)
+{
+  return huge_enabled ? HPAGE_SIZE : 0;
+}
+
+/*
+ * mem_granularity - returns the effective page granularity of the
+ *                   mapped page containing p: HPAGE_SIZE for pages
+ *                   that are (or are advised to be) backed by huge
+ *                   pages, otherwise mem_pagesize()
+ */
+size_t mem_granularity(void *p)
+{
+  int flags = pagemap_flags(p);
+
+  if ((flags & PAGEMAP_HUGETLB) || ((flags & PAGEMAP_HUGE) && thp_usable))
+    return HPAGE_SIZE;
+  return APAGE_SIZE;
+}
+
 /*
  * mem_pagesize() - returns the page size of the system
  */
@@ -63,15 +141,36 @@ size_t mem_heapsize(void)
   return APAGE_SIZE * page_count;
 }
 
+/*
+ * mem_residentsize - mapped bytes that have not been purged
+ */
+size_t mem_residentsize(void)
+{
+  return APAGE_SIZE * (page_count - purged_count);
+}
+
 
 void *mem_map(size_t sz)
+{
+  return mem_map_room(sz, 0);
+}
+
+/*
+ * mem_map_room - like mem_map, but also reserves the room bytes of
+ *     address space after the mapping, so that mem_map_at can later
+ *     grow the mapping into them wherever other mappings land. The
+ *     room is mapped PROT_NONE and MAP_NORESERVE, so it costs no
+ *     memory and isn't recorded in the page map. There is one room at
+ *     a time: the previous one is released first, as is the rest of
+ *     this one by mem_release_room or mem_reset.
+ */
+void *mem_map_room(size_t sz, size_t room)
 {
   void *p;
-  size_t i;
   
-  if (sz & (APAGE_SIZE - 1)) {
-    fprintf(stderr, "mem_map: requested size is not a multiple of %d: %ld\n",
-            APAGE_SIZE, sz);
+  if ((sz | room) & (APAGE_SIZE - 1)) {
+    fprintf(stderr, "mem_map_room: size or room is not a multiple of %d: %ld %ld\n",
+            APAGE_SIZE, sz, room);
     abort();
   }
 
@@ -82,19 +181,181 @@ void *mem_map(size_t sz)
     mmap(0, APAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
   }
 
-  p = mmap(0, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+  if (room > 0) {
+    mem_release_room();
+    p = mmap(0, sz + room, PROT_NONE, MAP_PRIVATE | MAP_ANON | MAP_NORESERVE, -1, 0);
+    if (p != MAP_FAILED
+        && mmap(p, sz, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANON | MAP_FIXED, -1, 0) == MAP_FAILED) {
+      munmap(p, sz + room);
+      p = MAP_FAILED;
+    }
+  } else
+    p = mmap(0, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
   if (p == MAP_FAILED) {
     fprintf(stderr, "mmap failed: %s (%d)\n",
             strerror(errno), errno);
     abort();
   }
+  if (room > 0) {
+    room_start = (char *)p + sz;
+    room_end = room_start + room;
+  }
+
+  record_pages(p, sz, 0);
+  
+  return p;
+}
+
+/*
+ * mem_release_room - unmap what is left of the room reserved by
+ *     mem_map_room, if any
+ */
+void mem_release_room(void)
+{
+  if (room_start != NULL && room_end > room_start)
+    munmap(room_start, room_end - room_start);
+  room_start = room_end = NULL;
+}
+
+/*
+ * mem_map_at - like mem_map, but only at p: maps [p, p+sz) and returns
+ *     p if nothing is mapped there yet, otherwise returns NULL. Used to
+ *     grow a mapping in place. The front of the reserved room is
+ *     mapped over, and a request that runs past the room fails.
+ */
+void *mem_map_at(void *p, size_t sz)
+{
+  void *q;
+
+  if ((((uintptr_t)p) | sz) & (APAGE_SIZE - 1)) {
+    fprintf(stderr, "mem_map_at: address or size is not a multiple of %d: %p %ld\n",
+            APAGE_SIZE, p, sz);
+    abort();
+  }
+
+  if ((char *)p == room_start && room_end - room_start >= (ptrdiff_t)sz) {
+    q = mmap(p, sz, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANON | MAP_FIXED, -1, 0);
+    if (q == MAP_FAILED)
+      return NULL;
+    room_start += sz;
+    record_pages(p, sz, 0);
+    return p;
+  }
+  /* past the room, whether the pages are free would depend on where
+     everything else happened to be mapped */
+  if ((char *)p == room_start)
+    return NULL;
+
+#ifdef MAP_FIXED_NOREPLACE
+  q = mmap(p, sz, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANON | MAP_FIXED_NOREPLACE, -1, 0);
+#else
+  q = mmap(p, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+#endif
+  if (q == MAP_FAILED)
+    return NULL;
+  if (q != p) {
+    /* kernels before 4.17 take the address as a hint only */
+    munmap(q, sz);
+    return NULL;
+  }
+
+  record_pages(p, sz, 0);
+
+  return p;
+}
+
+/*
+ * mem_map_huge - like mem_map, but the result is HPAGE_SIZE-aligned
+ *     and backed by huge pages where the system allows it: first
+ *     MAP_HUGETLB (when sz is a multiple of HPAGE_SIZE), otherwise an
+ *     aligned reservation advised with MADV_HUGEPAGE. Falls back to
+ *     mem_map when huge mappings are disabled.
+ */
+void *mem_map_huge(size_t sz)
+{
+  void *p;
+  size_t lead, reserve;
+
+  if (!huge_enabled)
+    return mem_map(sz);
+
+  if (sz & (APAGE_SIZE - 1)) {
+    fprintf(stderr, "mem_map_huge: requested size is not a multiple of %d: %ld\n",
+            APAGE_SIZE, sz);
+    abort();
+  }
+
+  activity_counter++;
+
+#ifdef MAP_HUGETLB
+  if (hugetlb_usable && !(sz & (HPAGE_SIZE - 1))) {
+    p = mmap(0, sz, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANON | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) {
+      record_pages(p, sz, PAGEMAP_HUGETLB);
+      return p;
+    }
+    /* no reserved huge pages; don't keep asking */
+    hugetlb_usable = 0;
+  }
+#endif
+
+  /* over-reserve, then trim to an HPAGE_SIZE-aligned range */
+  reserve = sz + HPAGE_SIZE - APAGE_SIZE;
+  p = mmap(0, reserve, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+  if (p == MAP_FAILED) {
+    fprintf(stderr, "mmap failed: %s (%d)\n",
+            strerror(errno), errno);
+    abort();
+  }
+  lead = (HPAGE_SIZE - (((uintptr_t)p) & (HPAGE_SIZE - 1))) & (HPAGE_SIZE - 1);
+  if (lead)
+    munmap(p, lead);
+  if (reserve - lead > sz)
+    munmap(p + lead + sz, reserve - lead - sz);
+  p += lead;
+
+#ifdef MADV_HUGEPAGE
+  if (thp_usable)
+    madvise(p, sz, MADV_HUGEPAGE);
+#endif
+
+  record_pages(p, sz, PAGEMAP_HUGE);
+
+  return p;
+}
+
+/*
+ * forget_pages - remove pages that are going away from the pagemap
+ */
+static void forget_pages(void *p, size_t sz)
+{
+  size_t i;
+
+  for (i = 0; i < sz; i += APAGE_SIZE) {
+    if (pagemap_flags(p + i) & PAGEMAP_PURGED)
+      --purged_count;
+    pagemap_modify(p + i, 0);
+    --page_count;
+  }
+}
+
+/*
+ * record_pages - register freshly mapped pages with the pagemap
+ */
+static void record_pages(void *p, size_t sz, int flags)
+{
+  size_t i;
 
   for (i = 0; i < sz; i += APAGE_SIZE) {
     pagemap_modify(p + i, 1);
+    if (flags)
+      pagemap_set_flags(p + i, flags);
     page_count++;
   }
-  
-  return p;
 }
 
 int check_mapped(void *p, size_t sz, int fail_with_error)
@@ -129,14 +390,9 @@ int check_mapped(void *p, size_t sz, int fail_with_error)
 
 void mem_unmap(void *p, size_t sz)
 {
-  size_t i;
-
   (void)check_mapped(p, sz, 1);
   
-  for (i = 0; i < sz; i += APAGE_SIZE) {
-    pagemap_modify(p + i, 0);
-    --page_count;
-  }
+  forget_pages(p, sz);
 
   if (munmap(p, sz) < 0) {
     fprintf(stderr, "munmap failed: %s (%d)\n",
@@ -145,7 +401,125 @@ void mem_unmap(void *p, size_t sz)
   }
 }
 
+/*
+ * mem_remap - grow or shrink the mapping [p, p+old_sz) to new_sz bytes
+ *     with mremap, moving it if necessary. The contents are carried
+ *     over by the page tables instead of being copied.
+ */
+void *mem_remap(void *p, size_t old_sz, size_t new_sz)
+{
+  void *q;
+  int flags;
+
+  (void)check_mapped(p, old_sz, 1);
+
+  if (new_sz & (APAGE_SIZE - 1)) {
+    fprintf(stderr, "mem_remap: requested size is not a multiple of %d: %ld\n",
+            APAGE_SIZE, new_sz);
+    abort();
+  }
+
+  flags = pagemap_flags(p);
+
+  q = mremap(p, old_sz, new_sz, MREMAP_MAYMOVE);
+  if (q == MAP_FAILED) {
+    fprintf(stderr, "mremap failed: %s (%d)\n",
+            strerror(errno), errno);
+    abort();
+  }
+
+  forget_pages(p, old_sz);
+
+  /* a moved THP mapping keeps its advice only if still aligned */
+  if ((flags & PAGEMAP_HUGE) && (((uintptr_t)q) & (HPAGE_SIZE - 1)))
+    flags = 0;
+  record_pages(q, new_sz, flags & ~PAGEMAP_PURGED);
+
+  return q;
+}
+
+/*
+ * mem_purge - give the physical pages of [p, p+sz) back to the OS
+ *     with MADV_DONTNEED while keeping them mapped. The pages read as
+ *     zero afterwards and are faulted back in on the next write.
+ *     The range has to be whole units of mem_granularity(p); anything
+ *     else is left alone and 0 is returned, otherwise 1.
+ */
+int mem_purge(void *p, size_t sz)
+{
+  size_t i, grain = mem_granularity(p);
+  int flags;
+
+  (void)check_mapped(p, sz, 1);
+
+  /* a hugetlb page can't be dropped in part, and dropping part of a
+     transparent huge page splits it */
+  if ((((uintptr_t)p) | sz) & (grain - 1))
+    return 0;
+
+  if (madvise(p, sz, MADV_DONTNEED) < 0) {
+    fprintf(stderr, "madvise failed: %s (%d)\n",
+            strerror(errno), errno);
+    abort();
+  }
+
+  for (i = 0; i < sz; i += APAGE_SIZE) {
+    flags = pagemap_flags(p + i);
+    if (!(flags & PAGEMAP_PURGED)) {
+      pagemap_set_flags(p + i, flags | PAGEMAP_PURGED);
+      purged_count++;
+    }
+  }
+  return 1;
+}
+
+/*
+ * mem_unpurge - note that the allocator is about to use [p, p+sz)
+ *     again, so any purged pages there count as resident. The range
+ *     need not be page-aligned.
+ */
+void mem_unpurge(void *p, size_t sz)
+{
+  void *page, *end;
+  int flags;
+
+  if (purged_count == 0)
+    return;
+
+  page = (void *)(((uintptr_t)p) & ~(uintptr_t)(APAGE_SIZE - 1));
+  end = p + sz;
+  for (; page < end; page += APAGE_SIZE) {
+    flags = pagemap_flags(page);
+    if (flags & PAGEMAP_PURGED) {
+      pagemap_set_flags(page, flags & ~PAGEMAP_PURGED);
+      purged_count--;
+    }
+  }
+}
+
 int mem_is_mapped(void *p, size_t sz)
 {
   return check_mapped(p, sz, 0);
 }
+
+/*
+ * mem_set_owner - tag each mapped page in [p, p+sz) with owner, a
+ *                 pointer of the caller's choosing; the tag is kept
+ *                 outside the pages and goes away when they are unmapped
+ */
+void mem_set_owner(void *p, size_t sz, void *owner)
+{
+  size_t i;
+
+  for (i = 0; i < sz; i += APAGE_SIZE)
+    pagemap_set_owner(p + i, owner);
+}
+
+/*
+ * mem_owner - the owner tag of the page containing p, or NULL if that
+ *             page is not mapped or has no owner; takes constant time
+ */
+void *mem_owner(void *p)
+{
+  return pagemap_owner((void *)((uintptr_t)p & ~(uintptr_t)(APAGE_SIZE-1)));
+}
@@ -5,7 +5,21 @@ void mem_reset(void);
 
 size_t mem_pagesize(void);
 void *mem_map(size_t);
+void *mem_map_room(size_t, size_t);
+void mem_release_room(void);
+void *mem_map_at(void *, size_t);
 void mem_unmap(void *, size_t);
+void *mem_remap(void *, size_t, size_t);
+int mem_purge(void *, size_t);
+void mem_unpurge(void *, size_t);
 int mem_is_mapped(void *p, size_t sz);
+void mem_set_owner(void *p, size_t sz, void *owner);
+void *mem_owner(void *p);
+
+void mem_set_huge(int enable);
+size_t mem_hugepagesize(void);
+void *mem_map_huge(size_t);
+size_t mem_granularity(void *p);
 
 size_t mem_heapsize(void);
+size_t mem_residentsize(void);
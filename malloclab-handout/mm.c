@@ -29,6 +29,13 @@
 /* rounds up to the nearest multiple of mem_pagesize() */
 #define PAGE_ALIGN(size) (((size) + (mem_pagesize()-1)) & ~(mem_pagesize()-1))
 
+/* place chunks of at least one huge page on huge-page mappings, when
+   memlib has huge mappings enabled (mem_hugepagesize() != 0) */
+#define USE_HUGE_CHUNKS 1
+
+/* rounds up to the nearest multiple of mem_hugepagesize() */
+#define HUGE_ALIGN(size) (((size) + (mem_hugepagesize()-1)) & ~(mem_hugepagesize()-1))
+
 //header and footer macros
 #define GET_SIZE(p) ((block_header *)(p))->size
 #define GET_ALLOC(p) ((block_header *)(p))->allocated
@@ -37,6 +44,10 @@
 #define FTRP(bp) ((char *)(bp)+GET_SIZE(HDRP(bp))-OVERHEAD)
 #define NEXT_BLKP(bp) ((char *)(bp) + GET_SIZE(HDRP(bp)))
 #define PREV_BLKP(bp) ((char *)(bp)-GET_SIZE((char *)(bp)-OVERHEAD))
+//a header's check field is a keyed hash of its address, size and allocated
+//value, so stray pointers and stale or mangled headers are rejected in O(1)
+#define GET_CHECK(p) ((block_header *)(p))->check
+#define SEAL(bp) (GET_CHECK(HDRP(bp)) = header_check(HDRP(bp)))
 //page macros
 #define ADDRESS_PAGE_START(p) ((void *)(((size_t)p) & ~(mem_pagesize()-1)))
 #define GET_NEXT_PAGE_PTR(ptr) ((pageHeaderBlock *)(ptr))->nextPage
@@ -46,26 +57,119 @@
 //free list macros
 #define GET_NEXT_FREE_PTR(ptr) ((freePointerBlock *)(ptr))->nextFree
 #define GET_PREV_FREE_PTR(ptr) ((freePointerBlock *)(ptr))->prevFree
+//huge block macros, a huge block sits alone in its own mapping so that
+//realloc can grow or move it with mem_remap instead of copying
+#define HUGE_BLOCK 2 //allocated value in the header of a huge block
+#define HUGE_BLOCK_MIN (32*4096) //requests at least this big become huge blocks
+#define HUGE_BLOCK_START(bp) ((char *)(bp) - 2*ALIGNMENT)
+#define HUGE_MAP_SIZE(bp) (GET_SIZE(HDRP(bp)) + 2*ALIGNMENT)
+#define HUGE_SIZE_COPY(bp) (*(size_t *)HUGE_BLOCK_START(bp)) //copy of the size in the unused page link, checked by mm_can_free
+#define IS_HUGE_ADDRESS(bp) (((size_t)(bp) & (mem_pagesize()-1)) == 2*ALIGNMENT) //no aligned chunk block sits here
+//aligned allocation macros
+#define MIN_FREE_BLOCK (OVERHEAD + ALIGNMENT) //smallest free block, room for the free list pointers
+#define ALIGN_UP(p, align) ((char *)(((size_t)(p) + (align)-1) & ~((align)-1)))
+//purge macros, free blocks that sit untouched long enough give their
+//interior pages back to the OS but keep their boundary tags
+#define GET_PURGED(p) ((block_header *)(p))->purged
+#define GET_TOUCHED(p) ((block_header *)(p))->touched
+#define PURGE_MIN_SIZE (4*4096) //only free blocks at least this big are purged
+#define PURGE_AGE 1024 //ops a free block must sit untouched before it is purged
+#define PURGE_INTERVAL 256 //ops between scans for purgeable blocks
+//zero macros, a free block's footer says how many bytes right in front of
+//it are still zero, from a fresh mapping or a purge, so mm_calloc can skip
+//clearing them; the count stays right when the block is split from the
+//front or merged with a block in front of it, since the footer doesn't move
+#define GET_ZEROED(p) ((block_footer *)(p))->zeroed
+#define ZEROED_MAX(bp) (GET_SIZE(HDRP(bp)) - OVERHEAD - sizeof(freePointerBlock)) //all but the free list pointers
+//quick list macros, small blocks are cached uncoalesced by exact size
+//when freed and handed straight back to mallocs of that size; the cache
+//is coalesced in a batch when it fills up or a malloc finds no fit
+#define QUICK_BLOCK 3 //allocated value in the header of a cached block
+#define QUICK_MAX_SIZE 512 //biggest block size that is cached
+#define QUICK_LISTS (QUICK_MAX_SIZE/ALIGNMENT + 1) //a list per block size, indexed by size/ALIGNMENT
+#define QUICK_COUNT_MAX 32 //blocks cached of each size, more are freed as usual
+#define QUICK_BYTES_MAX (16*4096) //bytes cached over all sizes before a flush
+#define QUICK_BLOCKS_MAX (QUICK_BYTES_MAX / MIN_FREE_BLOCK) //most blocks the cache can hold
+#define GROW_ROOM_MAX (64UL << 20) //most address space reserved for one chunk to grow into
+#define GROW_ROOM(chunkSize) (8*(chunkSize) < GROW_ROOM_MAX ? 8*(chunkSize) : GROW_ROOM_MAX) //address space reserved after a new chunk, see extend
+//check macros, the heap is validated incrementally: mm_check only looks at
+//the chunks and blocks touched since the last check
+#define MAX_CHUNKS 64 //chunks double in size, so this is plenty
+#define DIRTY_MAX 32 //blocks remembered between checks before falling back to a full check
+//bitmap macros, the tail of each chunk holds two bitmaps with a bit per
+//ALIGNMENT bytes: one marks where blocks start (at bp), the other which
+//of those are allocated
+#define BITMAP_BYTES(chunkSize) ((chunkSize) / (8*ALIGNMENT)) //bytes in each of a chunk's bitmaps
+#define WORD_BITS (8*sizeof(unsigned long))
+#define BIT_START 1 //block_bits of a block start
+#define BIT_ALLOC 2 //block_bits of an allocated block start, with BIT_START
+//stats macros, compiled away unless built with -DMM_STATS=1
+#ifndef MM_STATS
+#define MM_STATS 0
+#endif
+#if MM_STATS
+#define STAT_ADD(field, n) (mmStats.field += (n))
+#define STAT_MAX(field, n) do { if((n) > mmStats.field) mmStats.field = (n); } while(0)
+#else
+#define STAT_ADD(field, n) ((void)0)
+#define STAT_MAX(field, n) ((void)0)
+#endif
+//debug macros, DEBUG_ASSERT is compiled away unless built with -DMM_DEBUG=1
+#ifndef MM_DEBUG
+#define MM_DEBUG 0
+#endif
+#if MM_DEBUG
+#define DEBUG_ASSERT(x) assert(x)
+#else
+#define DEBUG_ASSERT(x) ((void)0)
+#endif
 
 
 void *firstPage = NULL; //points to first allocated page, right at start of pageHeaderBlock at front of page
+void *lastPage = NULL; //most recently mapped chunk, where extend links the next one
 void *current_avail = NULL; //this is free list pointer
 void *freeListPtr = NULL;
 void *endFreeListPtr = NULL;
 size_t current_avail_size = 0; //total amount of free memory
 size_t biggestFreeSize = 0; //current biggest free block of memory
 int numPagesToAllocate = 1;
+size_t reallocCopied = 0; //payload bytes mm_realloc moved with memcpy
+size_t reallocRemapped = 0; //payload bytes mm_realloc moved with mem_remap instead
+unsigned int opCount = 0; //malloc and free calls since mm_init, the clock for purging
+int freeOrder = MM_ORDER_LIFO; //free list order mm_init will use, see mm_set_free_order
+int addressOrdered = 0; //the free list is kept in address order, by chunk and then within it
+void *quickLists[QUICK_LISTS]; //cached blocks of each size, linked through their first payload word
+int quickCount[QUICK_LISTS];
+size_t quickBytes = 0; //bytes in all the quick lists
+int placement = MM_PLACE_LOCAL; //placement policy mm_init will use, see mm_set_placement
+int placeLocal = 0; //find_fit tries currentRegion before the free list
+void *currentRegion = NULL; //free block left over from the last allocation, if it is still free
+//the bump region is the front of the wilderness, taken off the free list
+//so that mallocs can be carved from it by moving a pointer; bump_flush
+//puts what is left back as a free block before anything else happens
+void *bumpPtr = NULL; //bp of the next block carved, NULL when there is no region
+char *bumpLimit = NULL; //where the region ends, the bp of the block after it
+void *bumpPrev = NULL; //the free block before the region on the free list
+char *bumpZero = NULL; //the region's bytes from here on are known to be zero
+char bumpPurged = 0; //header fields the wilderness had, for bump_flush
+unsigned int bumpTouched = 0;
+#if MM_STATS
+mm_stats_t mmStats; //hot-path counters since mm_init
+#endif
 
 typedef struct 
 {
 	size_t size;
 	char allocated;
+	char purged; //free block's interior pages have been purged since it was last touched
+	unsigned short check; //header_check of this header, see SEAL
+	unsigned int touched; //opCount when a free block was last freed or merged
 } block_header;
 
 typedef struct 
 {
 	size_t size;
-	int filler;
+	size_t zeroed; //free block: bytes just before the footer known to be zero, see GET_ZEROED
 } block_footer;
 
 typedef struct
@@ -80,15 +184,80 @@ typedef struct
 	void* prevFree;
 } freePointerBlock;
 
-static void *coalesce(void *bp);
+typedef struct
+{
+	char *start; //start of the mapping, where its pageHeaderBlock is
+	size_t size;
+	char *end; //the terminator header, just before the bitmaps
+	unsigned long *starts; //a bit per granule, set where a block starts
+	unsigned long *allocs; //set where an allocated block starts
+	int dirty; //page links or boundary blocks changed since the last check
+} chunkRecord;
+
+//chunks in the order they were mapped, kept out of the heap so that stray
+//writes to heap memory can't break the bounds checks; memlib tags each
+//chunk page with its record, and a huge block's pages with its start
+chunkRecord chunks[MAX_CHUNKS];
+int numChunks = 0;
+int lastChunkFound = 0;
+size_t checkKey = 0; //key for header_check, picked by mm_init
+void *dirtyBlocks[DIRTY_MAX]; //blocks changed since the last check
+int numDirty = 0;
+int checkAll = 0; //too many changes to remember, check the whole heap
+int heapCorrupt = 0; //found a bad block, stop using the heap until mm_init
+int checking = 0; //mm_check has been called since mm_init, so check blocks as they are touched
+
+static void *coalesce(void *bp, void **prevFree);
 static void set_allocated(void *bp, size_t size);
 static void extend(size_t new_size);
+static int grow_chunk(size_t new_size);
+static inline int is_wilderness(void *bp);
 static size_t findBiggestFreeBlock();
 static void *init_malloc(void *bp, size_t size);
-static void add_to_free_list(void *bp);
+static void add_to_free_list(void *bp, void *prev);
+static void *free_before(void *bp);
 static int checkIsMangled(void *p);
 static void removeFromFreeList(void *bp);
 static void addToFrontOfFreeList(void *ptr);
+static size_t huge_map_size(size_t size);
+static void *huge_malloc(size_t size);
+static void *realloc_in_place(void *bp, size_t newSize);
+static void purge_free_blocks(void);
+static void free_block(void *ptr);
+static void release_block(void *ptr);
+static void free_sorted(void **ptrs, size_t n);
+static void *take_quick(size_t size);
+static void start_bump(void *bp);
+static void *bump_block(size_t newSize, char **zeroed);
+static void bump_flush(void);
+static void flush_quick_lists(void);
+static int quick_node_ok(void *bp, size_t size);
+static void *malloc_block(size_t size, char **zeroed);
+static inline void trim_zeroed(void *bp);
+static inline char *zeroed_start(void *bp);
+static void *find_fit(size_t newSize);
+static void *find_aligned_fit(size_t newSize, size_t align, char **payload);
+static void carve_batch(void *p, size_t newSize, size_t n, void **out);
+static int compare_addresses(const void *a, const void *b);
+static int add_chunk(void *start, size_t size);
+static inline chunkRecord *find_chunk(void *p);
+static inline int header_ok(void *bp, chunkRecord *c);
+static int block_ok(void *bp, chunkRecord *c);
+static int free_node_ok(void *bp);
+static int next_free_ok(void *bp);
+static int links_ok(void *bp);
+static int neighbors_ok(void *bp, chunkRecord *c);
+static int check_block(void *bp);
+static int check_chunk(chunkRecord *c, int walk, size_t *freeCount);
+static int check_free_list(size_t freeCount);
+static int check_quick_lists(void);
+static int heap_corrupt(void);
+static void mark_dirty(void *bp);
+static void unmark_dirty(void *bp);
+static inline unsigned short header_check(void *h);
+static inline int block_bits(chunkRecord *c, void *bp);
+static void mark_block(void *bp);
+static void unmark_block(void *bp);
 
 /* 
  * mm_init - initialize the malloc package.
@@ -98,20 +267,43 @@ int mm_init(void)
 	mem_reset();
 	mem_init();
 	firstPage = NULL;
+	lastPage = NULL;
+	numChunks = 0;
+	lastChunkFound = 0;
+	numDirty = 0;
+	checkAll = 0;
+	heapCorrupt = 0;
+	checking = 0;
 	current_avail = NULL; //this is free list pointer
 	freeListPtr = NULL;
 	endFreeListPtr = NULL;
 	current_avail_size = 0;
 	biggestFreeSize = 0;
 	numPagesToAllocate = 1;
+	reallocCopied = 0;
+	reallocRemapped = 0;
+	opCount = 0;
+	addressOrdered = (freeOrder == MM_ORDER_ADDRESS);
+	memset(quickLists, 0, sizeof(quickLists));
+	memset(quickCount, 0, sizeof(quickCount));
+	quickBytes = 0;
+	placeLocal = (placement == MM_PLACE_LOCAL);
+	currentRegion = NULL;
+	bumpPtr = NULL;
+#if MM_STATS
+	memset(&mmStats, 0, sizeof(mmStats));
+#endif
 
 	size_t amount = PAGE_ALIGN(mem_pagesize());
 	amount *= numPagesToAllocate;
 	firstPage = mem_map(amount);
-	if(firstPage == NULL)
+	if(firstPage == NULL || !add_chunk(firstPage, amount))
 	{
 		return -1;
 	}
+	//where the heap lands differs from run to run, so it makes a cheap key
+	checkKey = ((size_t)firstPage >> 12) * 0x9E3779B97F4A7C15ULL;
+	lastPage = firstPage;
 	numPagesToAllocate *= 2;
 	GET_NEXT_PAGE_PTR(firstPage) = NULL;
 	GET_PREV_PAGE_PTR(firstPage) = NULL; //this is incorrect currently, put into struct. MACROS and functions? it might be right now?
@@ -119,15 +311,17 @@ int mm_init(void)
 	freeListPtr = firstPage + 2*ALIGNMENT; //Points to first payload block that is free
 
 	current_avail = firstPage + 2*ALIGNMENT; //skip over first 16 bytes for room of the pointers for page locations and header bytes to get to the start of the first payload
-	current_avail_size = amount - 2*ALIGNMENT; //can't include bytes needed for blank first buffer space, null terminator, or pointers to new pages
+	current_avail_size = amount - 2*ALIGNMENT - 2*BITMAP_BYTES(amount); //can't include bytes needed for blank first buffer space, null terminator, pointers to new pages, or the bitmaps
 	biggestFreeSize = current_avail_size;
 	//set free space header and footer blocks
 	GET_SIZE(HDRP(freeListPtr)) = current_avail_size;
 	GET_ALLOC(HDRP(freeListPtr)) = 0;
 	GET_SIZE(FTRP(freeListPtr)) = current_avail_size;
+	GET_ZEROED(FTRP(freeListPtr)) = ZEROED_MAX(freeListPtr); //fresh pages
 	//set terminator
 	GET_SIZE(HDRP(NEXT_BLKP(freeListPtr))) = 0;
 	GET_ALLOC(HDRP(NEXT_BLKP(freeListPtr))) = 1;
+	SEAL(NEXT_BLKP(freeListPtr));
 
 	//malloc the prologue block
 	freeListPtr = init_malloc(freeListPtr, 0);
@@ -135,6 +329,7 @@ int mm_init(void)
 	GET_NEXT_FREE_PTR(freeListPtr) = NULL;
 	GET_PREV_FREE_PTR(freeListPtr) = NULL;
 	biggestFreeSize = biggestFreeSize - 32;
+	mark_dirty(freeListPtr);
 	
   	return 0;
 }
@@ -145,33 +340,163 @@ int mm_init(void)
  */
 void *mm_malloc(size_t size)
 {
-	if(size == 0) //if they try to malloc nothing
+	return malloc_block(size, NULL);
+}
+
+/*
+ * mm_calloc - Allocate a block for nmemb elements of size bytes each,
+ * 	cleared to zero. Only the part of the payload that isn't already
+ * 	known to be zero is cleared: fresh chunk space and purged pages are
+ * 	skipped, and a huge block is a fresh mapping that needs no clearing.
+ */
+void *mm_calloc(size_t nmemb, size_t size)
+{
+	if(nmemb != 0 && size > (size_t)-1 / nmemb)
 	{
 		return NULL;
 	}
-	int newSize = ALIGN(size + OVERHEAD);
-	//printf("Just made newsize %d\n", newSize);
-	if (current_avail_size < newSize || biggestFreeSize < newSize) //change this to extend which will need to give us more memory 
+	size *= nmemb;
+	char *zeroed;
+	char *p = malloc_block(size, &zeroed);
+	if(p != NULL && zeroed > p)
 	{
-		//printf("Current availale size %d was less than new size %d\n", biggestFreeSize, newSize);
-		extend(newSize);
-		
-		if (endFreeListPtr == NULL)
+		size_t dirty = zeroed < p + size ? zeroed - p : size;
+		memset(p, 0, dirty);
+		STAT_ADD(calloc_cleared, dirty);
+	}
+	STAT_ADD(calloc_bytes, size);
+	return p;
+}
+
+
+/*
+ * mm_malloc_batch - Allocate n blocks of size bytes each into out, all
+ * 	carved one after another from a single free block, so the free
+ * 	list is searched and split once for the whole batch. Returns how
+ * 	many blocks were allocated, fewer than n only when out of memory.
+ */
+size_t mm_malloc_batch(size_t size, size_t n, void **out)
+{
+	size_t i = 0;
+	if(size == 0)
+	{
+		return 0;
+	}
+	size_t newSize = ALIGN(size + OVERHEAD);
+	bump_flush();
+	//huge blocks get a mapping each anyway, so only small ones are carved
+	if(n > 1 && size < HUGE_BLOCK_MIN && !heapCorrupt && n <= (size_t)-1 / newSize)
+	{
+		size_t total = newSize * n;
+		//a batch that doesn't fit is left to mm_malloc instead of growing
+		//the heap for it, since every extend doubles the next chunk
+		if(biggestFreeSize >= total)
 		{
-			return NULL;
+			STAT_ADD(mallocs, 1);
+			void *p = find_fit(total);
+			if(p != NULL)
+			{
+				carve_batch(p, newSize, n, out);
+				opCount += n;
+				i = n;
+			}
 		}
 	}
+	//whatever couldn't be carved is allocated one at a time
+	for(; i < n; i++)
+	{
+		if((out[i] = mm_malloc(size)) == NULL)
+		{
+			break;
+		}
+	}
+	return i;
+}
 
-	void *p = freeListPtr;
-	//printf("Set p to current avail %p\n", p);
-	//printf("Size of first block is: %d\n", GET_SIZE(HDRP(p)));
 
-	//this is first fit find of unallocated block with implicit free list rather than explicit
-	while (GET_SIZE(HDRP(p)) < newSize && GET_NEXT_FREE_PTR(p) != NULL) 
+/*
+ * mm_memalign - Allocate size bytes at an address that is a multiple of
+ * 	align, a power of two. Rather than allocating align extra bytes
+ * 	and trimming, the free list is searched for a block with a
+ * 	suitably aligned payload inside it, and the bytes in front of that
+ * 	payload stay on the free list as a block of their own.
+ */
+void *mm_memalign(size_t align, size_t size)
+{
+	if(size == 0 || (align & (align-1)) != 0)
 	{
-		p = GET_NEXT_FREE_PTR(p);
+		return NULL;
+	}
+	if(align <= ALIGNMENT)
+	{
+		return mm_malloc(size);
+	}
+	opCount++;
+	bump_flush();
+	//a huge block's payload is 2*ALIGNMENT past a page boundary, so it
+	//only serves alignments up to that
+	if((size >= HUGE_BLOCK_MIN || heapCorrupt) && align <= 2*ALIGNMENT)
+	{
+		return huge_malloc(size);
+	}
+	size_t newSize = ALIGN(size + OVERHEAD);
+	char *payload;
+	void *p = NULL;
+	if(!heapCorrupt)
+	{
+		STAT_ADD(mallocs, 1);
+		p = find_aligned_fit(newSize, align, &payload);
+	}
+	if(p == NULL && !heapCorrupt && quickBytes > 0)
+	{
+		flush_quick_lists();
+		p = find_aligned_fit(newSize, align, &payload);
+	}
+	if(p == NULL && !heapCorrupt)
+	{
+		//a fresh chunk has room for the payload wherever it starts
+		STAT_ADD(failed_fits, 1);
+		extend(newSize + align + MIN_FREE_BLOCK);
+		if(endFreeListPtr == NULL)
+		{
+			return NULL;
+		}
+		p = find_aligned_fit(newSize, align, &payload);
+	}
+	if(heapCorrupt)
+	{
+		//the payload has to be inside a huge block, where mm_can_free
+		//won't know it, so it is never freed; this only happens once
+		//the heap is lost anyway
+		p = huge_malloc(size + align);
+		return p == NULL ? NULL : ALIGN_UP(p, align);
+	}
+	if(p == NULL)
+	{
+		return NULL;
+	}
+	if(payload != p)
+	{
+		//p keeps the leading bytes, and stays where it is on the free list
+		block_header old = *(block_header *)HDRP(p);
+		size_t lead = payload - (char *)p;
+		STAT_ADD(splits, 1);
+		mem_unpurge(payload - OVERHEAD, OVERHEAD);
+		GET_SIZE(HDRP(p)) = lead;
+		GET_SIZE(FTRP(p)) = lead;
+		GET_ZEROED(FTRP(p)) = 0;
+		mark_block(p);
+		mark_dirty(p);
+		GET_SIZE(HDRP(payload)) = old.size - lead;
+		GET_SIZE(FTRP(payload)) = old.size - lead;
+		trim_zeroed(payload);
+		GET_ALLOC(HDRP(payload)) = 0;
+		GET_PURGED(HDRP(payload)) = old.purged;
+		GET_TOUCHED(HDRP(payload)) = old.touched;
+		mark_block(payload);
+		add_to_free_list(payload, p);
+		p = payload;
 	}
-	
 	set_allocated(p, newSize);
 	current_avail_size -= newSize;
 	biggestFreeSize = findBiggestFreeBlock();
@@ -193,7 +518,10 @@ static void *init_malloc(void *bp, size_t size)
 	GET_SIZE(HDRP(NEXT_BLKP(bp))) = extra_size;
 	GET_SIZE(FTRP(NEXT_BLKP(bp))) = extra_size;
 	GET_ALLOC(HDRP(NEXT_BLKP(bp))) = 0;
+	trim_zeroed(NEXT_BLKP(bp));
 	GET_ALLOC(HDRP(bp)) = 1;
+	mark_block(bp);
+	mark_block(NEXT_BLKP(bp));
 	current_avail_size -= newSize;
 	return NEXT_BLKP(bp);
 }
@@ -206,199 +534,1605 @@ void mm_free(void *ptr)
 	//printf("Calling free on %p\n", ptr);
 	if(mm_can_free(ptr)) //also maybe check mm_check returning 1
 	{
-		GET_ALLOC(HDRP(ptr)) = 0;
- 		ptr = coalesce(ptr);
-		addToFrontOfFreeList(ptr);
+		if(GET_ALLOC(HDRP(ptr)) == HUGE_BLOCK)
+		{
+			mem_unmap(HUGE_BLOCK_START(ptr), HUGE_MAP_SIZE(ptr));
+			return;
+		}
+		if(heapCorrupt)
+		{
+			return;
+		}
+		free_block(ptr);
 	}
 }
 
 /*
- * mm_check - Check whether the heap is ok, so that mm_malloc()
- *            and proper mm_free() calls won't crash.
+ * mm_free_sized - Free ptr, which the caller says was last allocated
+ * 	or reallocated with size bytes. With where ptr sits in its page,
+ * 	the size says whether it is a huge block and how big its mapping
+ * 	is, so unless mm_check is in use the pointer is trusted instead
+ * 	of checked with mm_can_free.
+ * 	Built with MM_DEBUG=1, the size is checked against the header.
  */
-int mm_check()
+void mm_free_sized(void *ptr, size_t size)
 {
-  return 1;
+	//checked or corrupt heaps don't trust the caller
+	if(ptr == NULL || checking || heapCorrupt)
+	{
+		mm_free(ptr);
+		return;
+	}
+	//big blocks from mm_memalign can be in a chunk, but never where a
+	//huge block's payload starts
+	if(size >= HUGE_BLOCK_MIN && IS_HUGE_ADDRESS(ptr))
+	{
+		DEBUG_ASSERT(mm_can_free(ptr) && GET_ALLOC(HDRP(ptr)) == HUGE_BLOCK
+			&& HUGE_MAP_SIZE(ptr) == huge_map_size(size));
+		mem_unmap(HUGE_BLOCK_START(ptr), huge_map_size(size));
+		return;
+	}
+	DEBUG_ASSERT(mm_can_free(ptr) && GET_ALLOC(HDRP(ptr)) == 1
+		&& GET_SIZE(HDRP(ptr)) >= ALIGN(size + OVERHEAD));
+	free_block(ptr);
 }
 
 /*
- * mm_check - Check whether freeing the given `p`, which means that
- *            calling mm_free(p) leaves the heap in an ok state.
+ * mm_free_batch - Free the n blocks in ptrs, which is sorted by address
+ * 	in the process. Blocks that sit next to each other are merged into
+ * 	one free block first, so each run is coalesced and put on the free
+ * 	list once. Pointers mm_free would ignore are skipped the same way.
  */
-int mm_can_free(void *p)
+void mm_free_batch(void **ptrs, size_t n)
 {
-  return GET_ALLOC(HDRP(p));
+	size_t i;
+	if(heapCorrupt)
+	{
+		for(i = 0; i < n; i++)
+		{
+			mm_free(ptrs[i]);
+		}
+		return;
+	}
+	qsort(ptrs, n, sizeof(void *), compare_addresses);
+	free_sorted(ptrs, n);
+	if((opCount + n) / PURGE_INTERVAL != opCount / PURGE_INTERVAL)
+	{
+		opCount += n;
+		purge_free_blocks();
+	}
+	else
+	{
+		opCount += n;
+	}
 }
 
 /*
- * coalesce - If two or more unallocated blocks are next to each
- *            other, then combine those unallocated blocks into
- *            one block.  Readjust free list pointers.
- */ 
-static void *coalesce(void *bp) //check video at malloc 18 at 3:30
+ * release_block - puts an allocated block back on the free list,
+ * coalescing it with its free neighbors.
+ */
+static void release_block(void *ptr)
 {
-	size_t prev_alloc = GET_ALLOC(HDRP(PREV_BLKP(bp)));
-	size_t next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp)));
-	size_t size = GET_SIZE(HDRP(bp));
-	if (prev_alloc && next_alloc) //both allocated
-	{ /* Case 1 */
-		//printf("Case 1 Coalescing\n");
-		/* nothing to do */
-		//add_to_free_list(bp);
-	}
-	else if (prev_alloc && !next_alloc) //one after is not allocated
-	{ /* Case 2 */
-		//printf("Case 2 Coalescing\n");
-		removeFromFreeList(NEXT_BLKP(bp));
+	bump_flush(); //ptr's neighbor may be the bump region
+	GET_ALLOC(HDRP(ptr)) = 0;
+	GET_ZEROED(FTRP(ptr)) = 0; //whatever the caller wrote is still there
+	mark_block(ptr);
+	void *prev;
+	ptr = coalesce(ptr, &prev);
+	add_to_free_list(ptr, prev);
+	mark_dirty(ptr);
+	GET_PURGED(HDRP(ptr)) = 0;
+	GET_TOUCHED(HDRP(ptr)) = opCount;
+}
 
-		size += GET_SIZE(HDRP(NEXT_BLKP(bp)));
+/*
+ * free_sorted - frees the blocks in ptrs, which is sorted by address.
+ * Runs of adjacent blocks are merged into one before coalescing, so each
+ * run costs a single free list insert.
+ */
+static void free_sorted(void **ptrs, size_t n)
+{
+	size_t i, j;
+	bump_flush();
+	for(i = 0; i < n; i = j)
+	{
+		void *bp = ptrs[i];
+		for(j = i + 1; j < n && ptrs[j] == bp; j++)
+		{
+			//a pointer given twice is freed once
+		}
+		if(!mm_can_free(bp))
+		{
+			continue;
+		}
+		if(GET_ALLOC(HDRP(bp)) == HUGE_BLOCK)
+		{
+			mm_free(bp);
+			continue;
+		}
+		//take in the blocks right after bp that are being freed too
+		size_t size = GET_SIZE(HDRP(bp));
+		while(j < n && (ptrs[j] == ptrs[j-1]
+			|| (ptrs[j] == (char *)bp + size && mm_can_free(ptrs[j]))))
+		{
+			if(ptrs[j] != ptrs[j-1])
+			{
+				size += GET_SIZE(HDRP(ptrs[j]));
+				unmark_dirty(ptrs[j]);
+				unmark_block(ptrs[j]);
+			}
+			j++;
+		}
 		GET_SIZE(HDRP(bp)) = size;
 		GET_SIZE(FTRP(bp)) = size;
+		GET_ZEROED(FTRP(bp)) = 0;
+		GET_ALLOC(HDRP(bp)) = 0;
+		mark_block(bp);
+		void *prev;
+		bp = coalesce(bp, &prev);
+		add_to_free_list(bp, prev);
+		mark_dirty(bp);
+		GET_PURGED(HDRP(bp)) = 0;
+		GET_TOUCHED(HDRP(bp)) = opCount;
 	}
-	else if (!prev_alloc && next_alloc) //one before is not allocated
-	{ /* Case 3 */
-		//printf("Case 3 Coalescing\n");
-		removeFromFreeList(PREV_BLKP(bp));
+}
 
-		size += GET_SIZE(HDRP(PREV_BLKP(bp)));
-		GET_SIZE(FTRP(bp)) = size;
-		GET_SIZE(HDRP(PREV_BLKP(bp))) = size;
-		bp = PREV_BLKP(bp);
-	}
-	else //both neighbor blocks are not allocated
-	{ /* Case 4 */
-		//printf("Case 4 Coalescing\n");
-		removeFromFreeList(NEXT_BLKP(bp));
-		removeFromFreeList(PREV_BLKP(bp));
+/*
+ * start_bump - takes the wilderness bp off the free list and makes it
+ * the bump region.
+ */
+static void start_bump(void *bp)
+{
+	bumpPrev = GET_PREV_FREE_PTR(bp);
+	removeFromFreeList(bp);
+	bumpPtr = bp;
+	bumpLimit = (char *)bp + GET_SIZE(HDRP(bp));
+	bumpZero = zeroed_start(bp);
+	bumpPurged = GET_PURGED(HDRP(bp));
+	bumpTouched = GET_TOUCHED(HDRP(bp));
+}
 
-		size += (GET_SIZE(HDRP(PREV_BLKP(bp))) + GET_SIZE(HDRP(NEXT_BLKP(bp))));
-		GET_SIZE(HDRP(PREV_BLKP(bp))) = size;
-		GET_SIZE(FTRP(NEXT_BLKP(bp))) = size;
-		bp = PREV_BLKP(bp);
+/*
+ * bump_block - carves a block of newSize bytes off the front of the bump
+ * region, writing only its header and footer. The caller has made sure
+ * the region keeps room for a free block.
+ */
+static void *bump_block(size_t newSize, char **zeroed)
+{
+	void *bp = bumpPtr;
+	if(bumpPurged)
+	{
+		mem_unpurge(HDRP(bp), newSize + 2*ALIGNMENT);
 	}
-	current_avail_size += size;
-	if(size > biggestFreeSize)
+	GET_SIZE(HDRP(bp)) = newSize;
+	GET_ALLOC(HDRP(bp)) = 1;
+	GET_SIZE(FTRP(bp)) = newSize;
+	mark_block(bp);
+	mark_dirty(bp);
+	bumpPtr = (char *)bp + newSize;
+	current_avail_size -= newSize;
+	if(zeroed != NULL)
 	{
-		biggestFreeSize = size;
+		//nothing past bumpPtr has been written since the region started
+		*zeroed = bumpZero > (char *)bp ? bumpZero : bp;
 	}
+	STAT_ADD(bumps, 1);
 	return bp;
 }
 
-
-static void add_to_free_list(void *bp)
-{
-
-}
-
 /*
-* Asks for more memory from operating system to increase heap for allocating when there isn't
-* enough free space to mm_alloc requesting a too big payload.
-*/
-static void extend(size_t new_size) 
+ * bump_flush - ends the bump region, putting what is left of it back on
+ * the free list where the wilderness was.
+ */
+static void bump_flush(void)
 {
-	size_t chunk_size = PAGE_ALIGN(new_size);
-	chunk_size *= numPagesToAllocate;
-	void* bp = mem_map(chunk_size);
+	void *bp = bumpPtr;
 	if(bp == NULL)
 	{
-		endFreeListPtr = NULL;
 		return;
 	}
-	numPagesToAllocate *= 2;
-	void* pagePtr = firstPage;
-	while(GET_NEXT_PAGE_PTR(pagePtr) != NULL)
+	bumpPtr = NULL;
+	size_t size = bumpLimit - (char *)bp;
+	GET_SIZE(HDRP(bp)) = size;
+	GET_ALLOC(HDRP(bp)) = 0;
+	GET_SIZE(FTRP(bp)) = size;
+	GET_PURGED(HDRP(bp)) = bumpPurged;
+	GET_TOUCHED(HDRP(bp)) = bumpTouched;
+	GET_ZEROED(FTRP(bp)) = bumpZero < FTRP(bp) ? FTRP(bp) - bumpZero : 0;
+	if(GET_ZEROED(FTRP(bp)) > ZEROED_MAX(bp))
 	{
-		pagePtr = GET_NEXT_PAGE_PTR(pagePtr);
+		GET_ZEROED(FTRP(bp)) = ZEROED_MAX(bp);
 	}
-	GET_NEXT_PAGE_PTR(pagePtr) = bp;
-	GET_NEXT_PAGE_PTR(bp) = NULL;
-	GET_PREV_PAGE_PTR(bp) = pagePtr;
-
-	chunk_size -= (2*ALIGNMENT); // account for unusable space in newly requested page
-	//buffer space to start so that payloads are 16 byte aligned, plus step over bytes for page pointers and over header block bytes
-	bp += 2*ALIGNMENT;
-	GET_SIZE(HDRP(bp)) = chunk_size;
-	GET_SIZE(FTRP(bp)) = chunk_size;
-	GET_ALLOC(HDRP(bp)) = 0;
-	GET_SIZE(HDRP(NEXT_BLKP(bp))) = 0;
-	GET_ALLOC(HDRP(NEXT_BLKP(bp))) = 1;
-
-	current_avail_size += chunk_size;
-	biggestFreeSize = chunk_size - 32;	
+	mark_block(bp);
+	add_to_free_list(bp, bumpPrev);
+	mark_dirty(bp);
+	currentRegion = bp;
+	biggestFreeSize = findBiggestFreeBlock();
+}
 
-	bp = init_malloc(bp, 0);
-	if(freeListPtr == NULL && endFreeListPtr == NULL)
+/*
+ * take_quick - pops a cached block of exactly size bytes and marks it
+ * allocated again, or returns NULL if there is none.
+ */
+static void *take_quick(size_t size)
+{
+	size_t i = size / ALIGNMENT;
+	void *bp = quickLists[i];
+	if(bp == NULL)
 	{
-		freeListPtr = bp;
-		endFreeListPtr = bp;
-		GET_NEXT_FREE_PTR(bp) = NULL;
-		GET_PREV_FREE_PTR(bp) = NULL;
+		return NULL;
 	}
-	else
+	if(checking && !quick_node_ok(bp, size))
 	{
-		//set to end of the free list
-		GET_NEXT_FREE_PTR(endFreeListPtr) = bp;
-		GET_PREV_FREE_PTR(bp) = endFreeListPtr;
-		GET_NEXT_FREE_PTR(bp) = NULL;
-		endFreeListPtr = bp;
+		//the rest of the list can't be trusted, so it is dropped
+		quickLists[i] = NULL;
+		heap_corrupt();
+		return NULL;
 	}
+	quickLists[i] = GET_NEXT_FREE_PTR(bp);
+	quickCount[i]--;
+	quickBytes -= size;
+	GET_ALLOC(HDRP(bp)) = 1;
+	mark_block(bp);
+	mark_dirty(bp);
+	STAT_ADD(quick_hits, 1);
+	return bp;
 }
 
 /*
-* Set the size of the header and footer for the malloced block and set the free size of the
-* remaining memory if there is any. Set the correct allocation bits.
-*/
-static void set_allocated(void *bp, size_t size) 
+ * flush_quick_lists - frees every cached block for real. They are freed
+ * in address order so neighbors freed close together coalesce as a run.
+ */
+static void flush_quick_lists(void)
 {
-	size_t extra_size = GET_SIZE(HDRP(bp)) - size;
-	removeFromFreeList(bp);
-	//when free block is split
-	if (extra_size > ALIGN(1 + OVERHEAD)) 
+	void *ptrs[QUICK_BLOCKS_MAX];
+	size_t n = 0;
+	size_t i;
+	for(i = 0; i < QUICK_LISTS; i++)
 	{
-		GET_SIZE(HDRP(bp)) = size;
-		GET_SIZE(FTRP(bp)) = size;
-		GET_SIZE(HDRP(NEXT_BLKP(bp))) = extra_size;
-		GET_SIZE(FTRP(NEXT_BLKP(bp))) = extra_size;
-		GET_ALLOC(HDRP(NEXT_BLKP(bp))) = 0;
-		
-		addToFrontOfFreeList(NEXT_BLKP(bp));
+		void *bp;
+		for(bp = quickLists[i]; bp != NULL && !heapCorrupt; bp = GET_NEXT_FREE_PTR(bp))
+		{
+			if(n == QUICK_BLOCKS_MAX || (checking && !quick_node_ok(bp, i * ALIGNMENT)))
+			{
+				heap_corrupt();
+				break;
+			}
+			ptrs[n++] = bp;
+		}
+		quickLists[i] = NULL;
+		quickCount[i] = 0;
 	}
-	GET_NEXT_FREE_PTR(bp) = NULL;
-	GET_PREV_FREE_PTR(bp) = NULL;
-	GET_ALLOC(HDRP(bp)) = 1;
+	quickBytes = 0;
+	if(heapCorrupt)
+	{
+		return;
+	}
+	//free_sorted only takes allocated blocks
+	for(i = 0; i < n; i++)
+	{
+		GET_ALLOC(HDRP(ptrs[i])) = 1;
+		mark_block(ptrs[i]);
+	}
+	qsort(ptrs, n, sizeof(void *), compare_addresses);
+	free_sorted(ptrs, n);
+	STAT_ADD(quick_flushes, 1);
 }
 
 /*
-* Find biggest unallocated block size.
-*/
-static size_t findBiggestFreeBlock()
+ * check_quick_lists - walks every quick list, checking each cached block
+ * and that the counts add up.
+ */
+static int check_quick_lists(void)
 {
-	size_t tempBiggest = 0;
-	void *p = freeListPtr;
-	if(p == NULL)
-	{
-		return tempBiggest;
-	}
-	while(GET_NEXT_FREE_PTR(p) != NULL)
+	size_t i;
+	size_t bytes = 0;
+	for(i = 0; i < QUICK_LISTS; i++)
 	{
-		if(GET_SIZE(HDRP(p)) > tempBiggest)
+		void *bp;
+		int count = 0;
+		for(bp = quickLists[i]; bp != NULL; bp = GET_NEXT_FREE_PTR(bp))
 		{
-			tempBiggest = GET_SIZE(HDRP(p));
+			if(count == quickCount[i] || !quick_node_ok(bp, i * ALIGNMENT))
+			{
+				return 0;
+			}
+			count++;
 		}
-		p = GET_NEXT_FREE_PTR(p);
+		if(count != quickCount[i])
+		{
+			return 0;
+		}
+		bytes += count * i * ALIGNMENT;
 	}
-	return tempBiggest;
+	return bytes == quickBytes;
 }
 
-static int checkIsMangled(void *p)
+/*
+ * quick_node_ok - whether bp is a sound cached block of the given size.
+ */
+static int quick_node_ok(void *bp, size_t size)
 {
-	void* changedP = ADDRESS_PAGE_START(p);
-    return !mem_is_mapped(changedP, PAGE_ALIGN((p + sizeof(pageHeaderBlock)) - changedP));
+	chunkRecord *c = find_chunk(HDRP(bp));
+	return c != NULL && block_ok(bp, c) && GET_ALLOC(HDRP(bp)) == QUICK_BLOCK
+		&& GET_SIZE(HDRP(bp)) == size && block_bits(c, bp) == (BIT_START | BIT_ALLOC);
 }
 
-
-static void removeFromFreeList(void *bp)
+/*
+ * mm_realloc - Resize the block at ptr to hold size bytes. Huge blocks
+ * 	are grown or moved by remapping their pages; other blocks grow
+ * 	into a free neighbor when they can and are copied otherwise.
+ */
+void *mm_realloc(void *ptr, size_t size)
 {
+	if(ptr == NULL)
+	{
+		return mm_malloc(size);
+	}
+	if(size == 0)
+	{
+		mm_free(ptr);
+		return NULL;
+	}
+
+	size_t oldSize;
+	void *newPtr;
+	bump_flush();
+	if(!mm_can_free(ptr))
+	{
+		//not a block we handed out, so there is nothing safe to copy
+		heap_corrupt();
+		return mm_malloc(size);
+	}
+	if(GET_ALLOC(HDRP(ptr)) == HUGE_BLOCK)
+	{
+		oldSize = GET_SIZE(HDRP(ptr));
+		if(size >= HUGE_BLOCK_MIN)
+		{
+			size_t mapSize = huge_map_size(size);
+			if(mapSize != HUGE_MAP_SIZE(ptr))
+			{
+				newPtr = mem_remap(HUGE_BLOCK_START(ptr), HUGE_MAP_SIZE(ptr), mapSize);
+				ptr = (char *)newPtr + 2*ALIGNMENT;
+				GET_SIZE(HDRP(ptr)) = mapSize - 2*ALIGNMENT;
+				HUGE_SIZE_COPY(ptr) = mapSize - 2*ALIGNMENT;
+				SEAL(ptr);
+				mem_set_owner(newPtr, mapSize, newPtr);
+				reallocRemapped += (oldSize < size) ? oldSize : size;
+			}
+			return ptr;
+		}
+	}
+	else
+	{
+		oldSize = GET_SIZE(HDRP(ptr)) - OVERHEAD;
+		if(size < HUGE_BLOCK_MIN && !heapCorrupt)
+		{
+			newPtr = realloc_in_place(ptr, ALIGN(size + OVERHEAD));
+			if(newPtr != NULL)
+			{
+				return newPtr;
+			}
+		}
+	}
+
+	//no room where it is, so move it
+	newPtr = mm_malloc(size);
+	if(newPtr == NULL)
+	{
+		return NULL;
+	}
+	if(size < oldSize)
+	{
+		oldSize = size;
+	}
+	memcpy(newPtr, ptr, oldSize);
+	reallocCopied += oldSize;
+	mm_free(ptr);
+	return newPtr;
+}
+
+/*
+ * mm_usable_size - The payload bytes the block at ptr really has, at
+ * 	least as many as it was allocated with. All of them can be written,
+ * 	and mm_realloc to any size up to this keeps the block where it is.
+ * 	Returns 0 for pointers mm_free would ignore.
+ */
+size_t mm_usable_size(void *ptr)
+{
+	if(!mm_can_free(ptr))
+	{
+		return 0;
+	}
+	if(GET_ALLOC(HDRP(ptr)) == HUGE_BLOCK)
+	{
+		//a huge block's payload runs to the end of its mapping
+		return GET_SIZE(HDRP(ptr));
+	}
+	return GET_SIZE(HDRP(ptr)) - OVERHEAD;
+}
+
+/*
+ * mm_good_size - The usable size mm_malloc(size) will give at least, so
+ * 	callers that grow buffers can ask for the whole of it up front.
+ * 	mm_malloc(mm_good_size(size)) gets the same kind of block as
+ * 	mm_malloc(size). A block can come back bigger still, when the free
+ * 	block it was split from had too little left over to split off.
+ */
+size_t mm_good_size(size_t size)
+{
+	if(size == 0)
+	{
+		return 0;
+	}
+	if(size >= HUGE_BLOCK_MIN)
+	{
+		return huge_map_size(size) - 2*ALIGNMENT;
+	}
+	//OVERHEAD is a multiple of ALIGNMENT, so only the payload is rounded
+	size = ALIGN(size);
+	return size < HUGE_BLOCK_MIN ? size : HUGE_BLOCK_MIN - 1;
+}
+
+/*
+ * mm_set_placement - Choose where mallocs go from the next mm_init on:
+ * 	MM_PLACE_FIRST_FIT takes the first block on the free list that
+ * 	fits, and MM_PLACE_LOCAL first tries what is left of the block the
+ * 	last allocation came from, so blocks allocated together end up on
+ * 	the same pages. Returns -1 for an unknown policy.
+ */
+int mm_set_placement(int policy)
+{
+	if(policy != MM_PLACE_FIRST_FIT && policy != MM_PLACE_LOCAL)
+	{
+		return -1;
+	}
+	placement = policy;
+	return 0;
+}
+
+/*
+ * mm_set_free_order - Choose how the free list is ordered from the next
+ * 	mm_init on: MM_ORDER_LIFO puts freed blocks at the front, and
+ * 	MM_ORDER_ADDRESS keeps the list in address order, so first fit
+ * 	packs blocks low. Returns -1 for an unknown order.
+ */
+int mm_set_free_order(int order)
+{
+	if(order != MM_ORDER_LIFO && order != MM_ORDER_ADDRESS)
+	{
+		return -1;
+	}
+	freeOrder = order;
+	return 0;
+}
+
+/*
+ * mm_realloc_stats - Report how many payload bytes mm_realloc has
+ * 	copied, and how many it moved by remapping pages instead, since
+ * 	mm_init.
+ */
+void mm_realloc_stats(size_t *copied, size_t *remapped)
+{
+	*copied = reallocCopied;
+	*remapped = reallocRemapped;
+}
+
+/*
+ * mm_free_summary - Report the number of free blocks and the size of
+ * 	the largest one, for tracking fragmentation.
+ */
+void mm_free_summary(size_t *count, size_t *largest)
+{
+	void *p = freeListPtr;
+	*count = 0;
+	*largest = 0;
+	if(heapCorrupt || (checking && p != NULL && !free_node_ok(p)))
+	{
+		return;
+	}
+	if(bumpPtr != NULL)
+	{
+		//the bump region is a free block that is off the list for now
+		*count = 1;
+		*largest = bumpLimit - (char *)bumpPtr;
+	}
+	while(p != NULL)
+	{
+		(*count)++;
+		if(GET_SIZE(HDRP(p)) > *largest)
+		{
+			*largest = GET_SIZE(HDRP(p));
+		}
+		if(checking && GET_NEXT_FREE_PTR(p) != NULL && !next_free_ok(p))
+		{
+			heap_corrupt();
+			return;
+		}
+		p = GET_NEXT_FREE_PTR(p);
+	}
+}
+
+/*
+ * mm_stats - Copy the hot-path counters gathered since mm_init into
+ * 	stats. Returns 0, with stats zeroed, when mm.c was built without
+ * 	MM_STATS.
+ */
+int mm_stats(mm_stats_t *stats)
+{
+#if MM_STATS
+	*stats = mmStats;
+	return 1;
+#else
+	memset(stats, 0, sizeof(*stats));
+	return 0;
+#endif
+}
+
+/*
+ * mm_check - Check whether the heap is ok, so that mm_malloc()
+ *            and proper mm_free() calls won't crash. Only the chunks
+ *            and blocks changed since the last check are looked at,
+ *            since once mm_check is in use, every free-list walk and
+ *            coalesce also checks the blocks it touches before trusting
+ *            them. The whole heap is checked when too much changed in
+ *            between.
+ */
+int mm_check()
+{
+	int i;
+	size_t freeCount = 0;
+	//the region goes back on the list before the walk, and is linked in
+	//as a checked operation since the list may already be mangled
+	checking = 1;
+	bump_flush();
+	if(heapCorrupt)
+	{
+		return 0;
+	}
+	if(checkAll)
+	{
+		for(i = 0; i < numChunks; i++)
+		{
+			if(!check_chunk(&chunks[i], 1, &freeCount))
+			{
+				return heap_corrupt();
+			}
+		}
+		if(!check_free_list(freeCount) || !check_quick_lists())
+		{
+			return heap_corrupt();
+		}
+	}
+	else
+	{
+		for(i = 0; i < numChunks; i++)
+		{
+			if(chunks[i].dirty && !check_chunk(&chunks[i], 0, NULL))
+			{
+				return heap_corrupt();
+			}
+		}
+		for(i = 0; i < numDirty; i++)
+		{
+			if(!check_block(dirtyBlocks[i]))
+			{
+				return heap_corrupt();
+			}
+		}
+	}
+	for(i = 0; i < numChunks; i++)
+	{
+		chunks[i].dirty = 0;
+	}
+	numDirty = 0;
+	checkAll = 0;
+	return 1;
+}
+
+/*
+ * mm_check - Check whether freeing the given `p`, which means that
+ *            calling mm_free(p) leaves the heap in an ok state.
+ */
+int mm_can_free(void *p)
+{
+  if(((size_t)p & (ALIGNMENT-1)) != 0)
+    return 0;
+  //the page owner says what p can be without reading anything else; an
+  //unmapped page has none
+  void *owner = mem_owner(HDRP(p));
+  chunkRecord *c = owner;
+  if(c >= chunks && c < chunks + numChunks)
+    return (char *)p < c->end && block_bits(c, p) == (BIT_START|BIT_ALLOC)
+      && block_ok(p, c) && GET_ALLOC(HDRP(p)) == 1;
+
+  //otherwise it can only be a huge block, alone at the start of its mapping
+  if(owner == NULL || (char *)p != (char *)owner + 2*ALIGNMENT)
+    return 0;
+  return GET_ALLOC(HDRP(p)) == HUGE_BLOCK && GET_CHECK(HDRP(p)) == header_check(HDRP(p))
+    && HUGE_SIZE_COPY(p) == GET_SIZE(HDRP(p));
+}
+
+/*
+ * mm_block_lookup - Find the allocated block whose payload holds addr,
+ *            for conservative pointer queries. Returns the block's
+ *            payload pointer, or NULL if addr is not inside an
+ *            allocated payload. The chunk bitmaps are scanned a word
+ *            at a time back from addr to the nearest block start.
+ */
+void *mm_block_lookup(void *addr)
+{
+  void *owner = mem_owner(addr);
+  chunkRecord *c = owner;
+  char *bp;
+  if(c >= chunks && c < chunks + numChunks)
+  {
+    if((char *)addr >= c->end)
+      return NULL;
+    size_t i = ((char *)addr - c->start) / ALIGNMENT;
+    size_t w = i / WORD_BITS;
+    unsigned long bits = c->starts[w] & (~0UL >> (WORD_BITS - 1 - i % WORD_BITS));
+    while(bits == 0)
+    {
+      if(w == 0)
+        return NULL;
+      bits = c->starts[--w];
+    }
+    bp = c->start + (w*WORD_BITS + WORD_BITS - 1 - __builtin_clzl(bits)) * ALIGNMENT;
+    //the bitmaps live in the heap too, so the header has to agree
+    if(block_bits(c, bp) != (BIT_START|BIT_ALLOC) || !header_ok(bp, c) || GET_ALLOC(HDRP(bp)) != 1
+       || (char *)addr >= bp + GET_SIZE(HDRP(bp)) - OVERHEAD)
+      return NULL;
+    return bp;
+  }
+
+  //otherwise it can only be in a huge block, which fills its mapping
+  if(owner == NULL)
+    return NULL;
+  bp = (char *)owner + 2*ALIGNMENT;
+  if((char *)addr < bp || GET_ALLOC(HDRP(bp)) != HUGE_BLOCK
+     || GET_CHECK(HDRP(bp)) != header_check(HDRP(bp)))
+    return NULL;
+  return bp;
+}
+
+/*
+ * coalesce - If two or more unallocated blocks are next to each
+ *            other, then combine those unallocated blocks into
+ *            one block.  Readjust free list pointers. prevFree is set
+ *            to the free block the result goes after in address order.
+ */ 
+static void *coalesce(void *bp, void **prevFree) //check video at malloc 18 at 3:30
+{
+	size_t prev_alloc = 1;
+	size_t next_alloc = 1;
+	size_t size = GET_SIZE(HDRP(bp));
+	//don't merge with neighbors that don't look like blocks
+	if(!checking || neighbors_ok(bp, find_chunk(HDRP(bp))))
+	{
+		prev_alloc = GET_ALLOC(HDRP(PREV_BLKP(bp)));
+		next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp)));
+	}
+	else
+	{
+		heap_corrupt();
+	}
+	if (prev_alloc && next_alloc) //both allocated
+	{ /* Case 1 */
+		//printf("Case 1 Coalescing\n");
+		/* nothing to do */
+		//add_to_free_list(bp);
+		STAT_ADD(coalesce[0], 1);
+		//only a block with no free neighbors has to look for its place
+		*prevFree = addressOrdered ? free_before(bp) : NULL;
+	}
+	else if (prev_alloc && !next_alloc) //one after is not allocated
+	{ /* Case 2 */
+		//printf("Case 2 Coalescing\n");
+		STAT_ADD(coalesce[1], 1);
+		*prevFree = GET_PREV_FREE_PTR(NEXT_BLKP(bp));
+		removeFromFreeList(NEXT_BLKP(bp));
+		unmark_dirty(NEXT_BLKP(bp));
+		unmark_block(NEXT_BLKP(bp));
+
+		size += GET_SIZE(HDRP(NEXT_BLKP(bp)));
+		GET_SIZE(HDRP(bp)) = size;
+		GET_SIZE(FTRP(bp)) = size;
+	}
+	else if (!prev_alloc && next_alloc) //one before is not allocated
+	{ /* Case 3 */
+		//printf("Case 3 Coalescing\n");
+		STAT_ADD(coalesce[2], 1);
+		*prevFree = GET_PREV_FREE_PTR(PREV_BLKP(bp));
+		removeFromFreeList(PREV_BLKP(bp));
+		unmark_dirty(bp);
+		unmark_block(bp);
+
+		size += GET_SIZE(HDRP(PREV_BLKP(bp)));
+		GET_SIZE(FTRP(bp)) = size;
+		GET_SIZE(HDRP(PREV_BLKP(bp))) = size;
+		bp = PREV_BLKP(bp);
+	}
+	else //both neighbor blocks are not allocated
+	{ /* Case 4 */
+		//printf("Case 4 Coalescing\n");
+		STAT_ADD(coalesce[3], 1);
+		removeFromFreeList(NEXT_BLKP(bp));
+		*prevFree = GET_PREV_FREE_PTR(PREV_BLKP(bp));
+		removeFromFreeList(PREV_BLKP(bp));
+		unmark_dirty(NEXT_BLKP(bp));
+		unmark_dirty(bp);
+		unmark_block(NEXT_BLKP(bp));
+		unmark_block(bp);
+
+		size += (GET_SIZE(HDRP(PREV_BLKP(bp))) + GET_SIZE(HDRP(NEXT_BLKP(bp))));
+		GET_SIZE(HDRP(PREV_BLKP(bp))) = size;
+		GET_SIZE(FTRP(NEXT_BLKP(bp))) = size;
+		bp = PREV_BLKP(bp);
+	}
+	mark_block(bp);
+	current_avail_size += size;
+	if(size > biggestFreeSize)
+	{
+		biggestFreeSize = size;
+	}
+	return bp;
+}
+
+
+/*
+* Put free block bp on the free list: at the front, or with address
+* ordering right after prev, the free block in front of it by address
+* (NULL if there is none). The wilderness always goes at the end.
+*/
+static void add_to_free_list(void *bp, void *prev)
+{
+	if(!addressOrdered)
+	{
+		prev = is_wilderness(bp) ? endFreeListPtr : NULL;
+	}
+	if(prev == NULL)
+	{
+		addToFrontOfFreeList(bp);
+		return;
+	}
+	if(checking && !free_node_ok(prev))
+	{
+		heap_corrupt();
+		addToFrontOfFreeList(bp);
+		return;
+	}
+	void *next = GET_NEXT_FREE_PTR(prev);
+	if(checking && next != NULL && !free_node_ok(next))
+	{
+		heap_corrupt();
+		addToFrontOfFreeList(bp);
+		return;
+	}
+	mark_dirty(prev);
+	GET_PREV_FREE_PTR(bp) = prev;
+	GET_NEXT_FREE_PTR(bp) = next;
+	GET_NEXT_FREE_PTR(prev) = bp;
+	if(next != NULL)
+	{
+		mark_dirty(next);
+		GET_PREV_FREE_PTR(next) = bp;
+	}
+	else
+	{
+		endFreeListPtr = bp;
+	}
+}
+
+/*
+* Find the free block closest in front of bp in address order, from the
+* block bitmaps a word (1KB of heap) at a time rather than by walking the
+* free list: first in bp's own chunk, then back from the end of each chunk
+* mapped before it. NULL if there is none.
+*/
+static void *free_before(void *bp)
+{
+	chunkRecord *c = find_chunk(HDRP(bp));
+	if(c == NULL)
+	{
+		return NULL;
+	}
+	size_t i = ((char *)bp - c->start) / ALIGNMENT; //bits below i
+	while(1)
+	{
+		size_t w = i / WORD_BITS;
+		unsigned long bits = c->starts[w] & ~c->allocs[w] & ((1UL << (i % WORD_BITS)) - 1);
+		while(bits == 0 && w > 0)
+		{
+			w--;
+			bits = c->starts[w] & ~c->allocs[w];
+		}
+		if(bits != 0)
+		{
+			return c->start + (w*WORD_BITS + WORD_BITS - 1 - __builtin_clzl(bits)) * ALIGNMENT;
+		}
+		if(c == chunks)
+		{
+			return NULL;
+		}
+		c--;
+		i = (c->end - c->start) / ALIGNMENT;
+	}
+}
+
+/*
+* Asks for more memory from operating system to increase heap for allocating when there isn't
+* enough free space to mm_alloc requesting a too big payload.
+*/
+static void extend(size_t new_size) 
+{
+	size_t chunk_size = PAGE_ALIGN(new_size);
+	chunk_size *= numPagesToAllocate;
+	void* bp;
+	//large chunks go on huge pages to cut TLB misses while walking the free list
+	if(USE_HUGE_CHUNKS && mem_hugepagesize() != 0 && chunk_size >= mem_hugepagesize())
+	{
+		chunk_size = HUGE_ALIGN(chunk_size);
+		mem_release_room(); //a huge chunk is never grown, so the last room is done with
+		bp = mem_map_huge(chunk_size);
+	}
+	else if(grow_chunk(new_size))
+	{
+		return;
+	}
+	else
+	{
+		//reserve address space after the chunk for grow_chunk, so it
+		//can grow there whatever else gets mapped in the meantime
+		bp = mem_map_room(chunk_size, GROW_ROOM(chunk_size));
+	}
+	if(bp == NULL || !add_chunk(bp, chunk_size))
+	{
+		endFreeListPtr = NULL;
+		return;
+	}
+	STAT_ADD(extends, 1);
+	STAT_ADD(bytes_mapped, chunk_size);
+	numPagesToAllocate *= 2;
+	GET_NEXT_PAGE_PTR(lastPage) = bp;
+	GET_NEXT_PAGE_PTR(bp) = NULL;
+	GET_PREV_PAGE_PTR(bp) = lastPage;
+	find_chunk(lastPage)->dirty = 1;
+	lastPage = bp;
+
+	chunk_size -= (2*ALIGNMENT) + 2*BITMAP_BYTES(chunk_size); // account for unusable space in newly requested page
+	//buffer space to start so that payloads are 16 byte aligned, plus step over bytes for page pointers and over header block bytes
+	bp += 2*ALIGNMENT;
+	GET_SIZE(HDRP(bp)) = chunk_size;
+	GET_SIZE(FTRP(bp)) = chunk_size;
+	GET_ZEROED(FTRP(bp)) = ZEROED_MAX(bp);
+	GET_ALLOC(HDRP(bp)) = 0;
+	GET_SIZE(HDRP(NEXT_BLKP(bp))) = 0;
+	GET_ALLOC(HDRP(NEXT_BLKP(bp))) = 1;
+	SEAL(NEXT_BLKP(bp));
+
+	current_avail_size += chunk_size;
+	biggestFreeSize = chunk_size - 32;	
+
+	bp = init_malloc(bp, 0);
+	if(freeListPtr == NULL && endFreeListPtr == NULL)
+	{
+		freeListPtr = bp;
+		endFreeListPtr = bp;
+		GET_NEXT_FREE_PTR(bp) = NULL;
+		GET_PREV_FREE_PTR(bp) = NULL;
+	}
+	else
+	{
+		//set to end of the free list
+		GET_NEXT_FREE_PTR(endFreeListPtr) = bp;
+		GET_PREV_FREE_PTR(bp) = endFreeListPtr;
+		GET_NEXT_FREE_PTR(bp) = NULL;
+		mark_dirty(endFreeListPtr);
+		endFreeListPtr = bp;
+	}
+	mark_dirty(bp);
+}
+
+/*
+* Grow the most recent chunk in place by mapping pages right after it, so
+* they join the free block at its tail (the wilderness) instead of opening
+* a new chunk with its own prologue and terminator. The bitmaps move to the
+* new end of the chunk. Returns 0 if the pages after the chunk are taken.
+*/
+static int grow_chunk(size_t new_size)
+{
+	chunkRecord *c = &chunks[numChunks - 1];
+	void *tail = PREV_BLKP(c->end + sizeof(block_header));
+	size_t have = 0;
+	if(checking && !block_ok(tail, c))
+	{
+		return 0; //leave it for mm_check to report
+	}
+	if(GET_ALLOC(HDRP(tail)) == 0)
+	{
+		if(checking && !free_node_ok(tail))
+		{
+			return 0; //leave it for mm_check to report
+		}
+		have = GET_SIZE(HDRP(tail));
+	}
+	else
+	{
+		tail = NULL;
+	}
+	//the bitmaps take 2*BITMAP_BYTES of whatever is added
+	size_t need = new_size > have ? new_size - have : ALIGNMENT;
+	size_t extra = PAGE_ALIGN(need + 2*BITMAP_BYTES(need) + ALIGNMENT);
+	if(mem_map_at(c->start + c->size, extra) == NULL)
+	{
+		return 0;
+	}
+	STAT_ADD(grows, 1);
+	STAT_ADD(bytes_mapped, extra);
+	mem_set_owner(c->start + c->size, extra, c);
+
+	char *oldEnd = c->end;
+	char *fresh = c->start + c->size; //the new pages read as zero
+	unsigned long *oldStarts = c->starts;
+	unsigned long *oldAllocs = c->allocs;
+	size_t oldBytes = BITMAP_BYTES(c->size);
+	c->size += extra;
+	c->starts = (unsigned long *)(c->start + c->size - 2*BITMAP_BYTES(c->size));
+	c->allocs = (unsigned long *)(c->start + c->size - BITMAP_BYTES(c->size));
+	c->end = (char *)c->starts - sizeof(block_header);
+	c->dirty = 1;
+	//allocs first, the new starts bitmap can land on the old allocs one
+	memmove(c->allocs, oldAllocs, oldBytes);
+	memset((char *)c->allocs + oldBytes, 0, BITMAP_BYTES(c->size) - oldBytes);
+	memmove(c->starts, oldStarts, oldBytes);
+	memset((char *)c->starts + oldBytes, 0, BITMAP_BYTES(c->size) - oldBytes);
+
+	size_t gain = c->end - oldEnd;
+	if(tail != NULL)
+	{
+		GET_SIZE(HDRP(tail)) = have + gain;
+		GET_SIZE(FTRP(tail)) = have + gain;
+		mark_block(tail);
+	}
+	else
+	{
+		//the old terminator becomes the header of the new free block
+		tail = oldEnd + sizeof(block_header);
+		GET_SIZE(HDRP(tail)) = gain;
+		GET_ALLOC(HDRP(tail)) = 0;
+		GET_SIZE(FTRP(tail)) = gain;
+		GET_PURGED(HDRP(tail)) = 0;
+		GET_TOUCHED(HDRP(tail)) = opCount;
+		mark_block(tail);
+		add_to_free_list(tail, endFreeListPtr);
+	}
+	GET_ZEROED(FTRP(tail)) = FTRP(tail) > fresh ? FTRP(tail) - fresh : 0;
+	if(GET_ZEROED(FTRP(tail)) > ZEROED_MAX(tail))
+	{
+		GET_ZEROED(FTRP(tail)) = ZEROED_MAX(tail);
+	}
+	mark_dirty(tail);
+	GET_SIZE(c->end) = 0;
+	GET_ALLOC(c->end) = 1;
+	SEAL(c->end + sizeof(block_header));
+
+	current_avail_size += gain;
+	if(GET_SIZE(HDRP(tail)) > biggestFreeSize)
+	{
+		biggestFreeSize = GET_SIZE(HDRP(tail));
+	}
+	return 1;
+}
+
+/*
+* Whether free block bp is the wilderness, the one that ends the most
+* recent chunk. It is carved from last, since it is the block that can
+* grow.
+*/
+static inline int is_wilderness(void *bp)
+{
+	return HDRP(NEXT_BLKP(bp)) == chunks[numChunks - 1].end;
+}
+
+/*
+* Set the size of the header and footer for the malloced block and set the free size of the
+* remaining memory if there is any. Set the correct allocation bits.
+*/
+static void set_allocated(void *bp, size_t size) 
+{
+	size_t extra_size = GET_SIZE(HDRP(bp)) - size;
+	void *prev = GET_PREV_FREE_PTR(bp); //the remainder takes bp's place
+	removeFromFreeList(bp);
+	//pages of a purged block come back as soon as they are written
+	mem_unpurge(HDRP(bp), size + 2*ALIGNMENT);
+	//when free block is split
+	if (extra_size > ALIGN(1 + OVERHEAD)) 
+	{
+		block_header old = *(block_header *)HDRP(bp);
+		STAT_ADD(splits, 1);
+		GET_SIZE(HDRP(bp)) = size;
+		GET_SIZE(FTRP(bp)) = size;
+		GET_SIZE(HDRP(NEXT_BLKP(bp))) = extra_size;
+		GET_SIZE(FTRP(NEXT_BLKP(bp))) = extra_size;
+		GET_ALLOC(HDRP(NEXT_BLKP(bp))) = 0;
+		GET_PURGED(HDRP(NEXT_BLKP(bp))) = old.purged;
+		GET_TOUCHED(HDRP(NEXT_BLKP(bp))) = old.touched;
+		trim_zeroed(NEXT_BLKP(bp));
+		
+		mark_block(NEXT_BLKP(bp));
+		add_to_free_list(NEXT_BLKP(bp), prev);
+		mark_dirty(NEXT_BLKP(bp));
+		currentRegion = NEXT_BLKP(bp);
+	}
+	GET_NEXT_FREE_PTR(bp) = NULL;
+	GET_PREV_FREE_PTR(bp) = NULL;
+	GET_ALLOC(HDRP(bp)) = 1;
+	mark_block(bp);
+	mark_dirty(bp);
+}
+
+/*
+* First fit search of the free list for a block of at least newSize
+* bytes. The caller has made sure one exists, so NULL means a node along
+* the way didn't check out and the heap is now marked corrupt.
+*/
+static void *find_fit(size_t newSize)
+{
+	void *p = currentRegion;
+	//the rest of the block the last allocation came from keeps blocks
+	//allocated together on the same pages
+	if(placeLocal && p != NULL)
+	{
+		if(checking && !free_node_ok(p))
+		{
+			heap_corrupt();
+			return NULL;
+		}
+		if(GET_SIZE(HDRP(p)) >= newSize)
+		{
+			STAT_ADD(region_hits, 1);
+			return p;
+		}
+	}
+	p = freeListPtr;
+	if(checking && !free_node_ok(p))
+	{
+		heap_corrupt();
+		return NULL;
+	}
+
+	//this is first fit find of unallocated block with implicit free list rather than explicit
+	size_t visited = 1;
+	while (GET_SIZE(HDRP(p)) < newSize && GET_NEXT_FREE_PTR(p) != NULL) 
+	{
+		//every node is checked before it is trusted
+		if(checking && !next_free_ok(p))
+		{
+			heap_corrupt();
+			return NULL;
+		}
+		p = GET_NEXT_FREE_PTR(p);
+		visited++;
+	}
+	if(GET_SIZE(HDRP(p)) < newSize || (checking && !block_ok(p, find_chunk(HDRP(p)))))
+	{
+		heap_corrupt();
+		return NULL;
+	}
+	STAT_ADD(nodes_visited, visited);
+	STAT_MAX(max_visited, visited);
+	if(visited == 1)
+	{
+		STAT_ADD(bin_hits, 1);
+	}
+	else
+	{
+		STAT_ADD(bin_misses, 1);
+	}
+	return p;
+}
+
+/*
+* First fit search of the free list for a block with room for a block of
+* newSize bytes whose payload is a multiple of align. The payload goes in
+* *payload; it is either the free block's own or far enough in to leave
+* a free block in front. Returns NULL if there is no such block, or if a
+* node didn't check out, in which case the heap is marked corrupt.
+*/
+static void *find_aligned_fit(size_t newSize, size_t align, char **payload)
+{
+	void *p = freeListPtr;
+	char *a;
+	if(p == NULL)
+	{
+		return NULL;
+	}
+	if(checking && !free_node_ok(p))
+	{
+		heap_corrupt();
+		return NULL;
+	}
+	while(1)
+	{
+		a = ALIGN_UP(p, align);
+		if(a != p && (size_t)(a - (char *)p) < MIN_FREE_BLOCK)
+		{
+			a += align;
+		}
+		if((size_t)(a - (char *)p) + newSize <= GET_SIZE(HDRP(p)))
+		{
+			break;
+		}
+		if(GET_NEXT_FREE_PTR(p) == NULL)
+		{
+			return NULL;
+		}
+		if(checking && !next_free_ok(p))
+		{
+			heap_corrupt();
+			return NULL;
+		}
+		p = GET_NEXT_FREE_PTR(p);
+	}
+	if(checking && !block_ok(p, find_chunk(HDRP(p))))
+	{
+		heap_corrupt();
+		return NULL;
+	}
+	*payload = a;
+	return p;
+}
+
+/*
+* Split free block p into n allocated blocks of newSize bytes, stored in
+* out, and a free remainder if there is enough left over for one.
+*/
+static void carve_batch(void *p, size_t newSize, size_t n, void **out)
+{
+	size_t total = newSize * n;
+	size_t extra_size = GET_SIZE(HDRP(p)) - total;
+	block_header old = *(block_header *)HDRP(p);
+	int split = extra_size > ALIGN(1 + OVERHEAD);
+	size_t i;
+	void *bp;
+	void *prev = GET_PREV_FREE_PTR(p);
+	removeFromFreeList(p);
+	mem_unpurge(HDRP(p), total + 2*ALIGNMENT);
+	for(i = 0; i < n; i++)
+	{
+		bp = (char *)p + i*newSize;
+		//a remainder too small to be a block stays with the last one
+		GET_SIZE(HDRP(bp)) = (i < n-1 || split) ? newSize : newSize + extra_size;
+		GET_SIZE(FTRP(bp)) = GET_SIZE(HDRP(bp));
+		GET_ALLOC(HDRP(bp)) = 1;
+		mark_block(bp);
+		mark_dirty(bp);
+		out[i] = bp;
+	}
+	if(split)
+	{
+		STAT_ADD(splits, 1);
+		bp = (char *)p + total;
+		GET_SIZE(HDRP(bp)) = extra_size;
+		GET_SIZE(FTRP(bp)) = extra_size;
+		GET_ALLOC(HDRP(bp)) = 0;
+		GET_PURGED(HDRP(bp)) = old.purged;
+		GET_TOUCHED(HDRP(bp)) = old.touched;
+		trim_zeroed(bp);
+		mark_block(bp);
+		add_to_free_list(bp, prev);
+		mark_dirty(bp);
+	}
+	else
+	{
+		total += extra_size;
+	}
+	current_avail_size -= total;
+	biggestFreeSize = findBiggestFreeBlock();
+}
+
+/*
+* qsort comparison for mm_free_batch, lower addresses first.
+*/
+static int compare_addresses(const void *a, const void *b)
+{
+	char *x = *(char * const *)a, *y = *(char * const *)b;
+	return (x > y) - (x < y);
+}
+
+/*
+* Map a huge block of at least size payload bytes in its own chunk.
+*/
+static void *huge_malloc(size_t size)
+{
+	size_t mapSize = huge_map_size(size);
+	void *bp;
+	if(USE_HUGE_CHUNKS && mem_hugepagesize() != 0 && mapSize >= mem_hugepagesize())
+	{
+		bp = mem_map_huge(mapSize);
+	}
+	else
+	{
+		bp = mem_map(mapSize);
+	}
+	if(bp == NULL)
+	{
+		return NULL;
+	}
+	STAT_ADD(bytes_mapped, mapSize);
+	GET_NEXT_PAGE_PTR(bp) = NULL;
+	GET_PREV_PAGE_PTR(bp) = NULL;
+	bp += 2*ALIGNMENT;
+	GET_SIZE(HDRP(bp)) = mapSize - 2*ALIGNMENT;
+	GET_ALLOC(HDRP(bp)) = HUGE_BLOCK;
+	HUGE_SIZE_COPY(bp) = mapSize - 2*ALIGNMENT;
+	SEAL(bp);
+	mem_set_owner(HUGE_BLOCK_START(bp), mapSize, HUGE_BLOCK_START(bp));
+	return bp;
+}
+
+/*
+* Number of bytes to map for a huge block with size payload bytes.
+*/
+static size_t huge_map_size(size_t size)
+{
+	size_t mapSize = PAGE_ALIGN(size + 2*ALIGNMENT);
+	if(USE_HUGE_CHUNKS && mem_hugepagesize() != 0 && mapSize >= mem_hugepagesize())
+	{
+		mapSize = HUGE_ALIGN(mapSize);
+	}
+	return mapSize;
+}
+
+/*
+* Resize an allocated block without moving it, either because it is
+* already big enough or because the next block is free and big enough
+* to make up the difference. Returns NULL when it can't.
+*/
+static void *realloc_in_place(void *bp, size_t newSize)
+{
+	size_t size = GET_SIZE(HDRP(bp));
+	if(newSize <= size)
+	{
+		return bp;
+	}
+	void *next = NEXT_BLKP(bp);
+	if(checking && !neighbors_ok(bp, find_chunk(HDRP(bp))))
+	{
+		heap_corrupt();
+		return NULL;
+	}
+	if(GET_ALLOC(HDRP(next)) || size + GET_SIZE(HDRP(next)) < newSize)
+	{
+		return NULL;
+	}
+
+	void *prev = GET_PREV_FREE_PTR(next);
+	removeFromFreeList(next);
+	unmark_dirty(next);
+	unmark_block(next);
+	mem_unpurge(HDRP(next), newSize - size + 2*ALIGNMENT);
+	block_header old = *(block_header *)HDRP(next);
+	size += GET_SIZE(HDRP(next));
+	current_avail_size -= GET_SIZE(HDRP(next));
+	size_t extra_size = size - newSize;
+	if (extra_size > ALIGN(1 + OVERHEAD))
+	{
+		STAT_ADD(splits, 1);
+		GET_SIZE(HDRP(bp)) = newSize;
+		GET_SIZE(FTRP(bp)) = newSize;
+		GET_SIZE(HDRP(NEXT_BLKP(bp))) = extra_size;
+		GET_SIZE(FTRP(NEXT_BLKP(bp))) = extra_size;
+		GET_ALLOC(HDRP(NEXT_BLKP(bp))) = 0;
+		GET_PURGED(HDRP(NEXT_BLKP(bp))) = old.purged;
+		GET_TOUCHED(HDRP(NEXT_BLKP(bp))) = old.touched;
+		trim_zeroed(NEXT_BLKP(bp));
+		current_avail_size += extra_size;
+		mark_block(NEXT_BLKP(bp));
+		add_to_free_list(NEXT_BLKP(bp), prev);
+		mark_dirty(NEXT_BLKP(bp));
+	}
+	else
+	{
+		GET_SIZE(HDRP(bp)) = size;
+		GET_SIZE(FTRP(bp)) = size;
+	}
+	mark_block(bp);
+	mark_dirty(bp);
+	biggestFreeSize = findBiggestFreeBlock();
+	return bp;
+}
+
+/*
+* Allocate a block for mm_malloc or mm_calloc. When zeroed isn't NULL it
+* is set to where the zero bytes at the end of the new payload begin, p
+* itself if the whole payload is zero.
+*/
+static void *malloc_block(size_t size, char **zeroed)
+{
+	if(size == 0) //if they try to malloc nothing
+	{
+		return NULL;
+	}
+	opCount++;
+	//once the heap is known to be corrupt, every block gets its own mapping
+	if(size >= HUGE_BLOCK_MIN || heapCorrupt)
+	{
+		void *p = huge_malloc(size);
+		if(zeroed != NULL)
+		{
+			*zeroed = p;
+		}
+		return p;
+	}
+	int newSize = ALIGN(size + OVERHEAD);
+	//printf("Just made newsize %d\n", newSize);
+	if(newSize <= QUICK_MAX_SIZE)
+	{
+		void *p = take_quick(newSize);
+		if(p != NULL)
+		{
+			if(zeroed != NULL)
+			{
+				//the old contents are still there
+				*zeroed = (char *)p + size;
+			}
+			return p;
+		}
+		if(heapCorrupt)
+		{
+			return malloc_block(size, zeroed);
+		}
+	}
+	if(bumpPtr != NULL)
+	{
+		//a free block has to be left behind, as set_allocated would
+		if(bumpLimit - (char *)bumpPtr >= newSize + MIN_FREE_BLOCK)
+		{
+			return bump_block(newSize, zeroed);
+		}
+		bump_flush();
+	}
+	STAT_ADD(mallocs, 1);
+	if((current_avail_size < newSize || biggestFreeSize < newSize) && quickBytes > 0)
+	{
+		flush_quick_lists();
+	}
+	if (current_avail_size < newSize || biggestFreeSize < newSize) //change this to extend which will need to give us more memory 
+	{
+		//printf("Current availale size %d was less than new size %d\n", biggestFreeSize, newSize);
+		STAT_ADD(failed_fits, 1);
+		extend(newSize);
+		
+		if (endFreeListPtr == NULL)
+		{
+			return NULL;
+		}
+	}
+
+	void *p = find_fit(newSize);
+	//printf("Set p to current avail %p\n", p);
+	if(p == NULL)
+	{
+		p = huge_malloc(size);
+		if(zeroed != NULL)
+		{
+			*zeroed = p;
+		}
+		return p;
+	}
+	//fresh space is bumped through until something else happens, which
+	//includes mm_check, so the region never has to be walked
+	if(is_wilderness(p) && GET_SIZE(HDRP(p)) >= newSize + MIN_FREE_BLOCK)
+	{
+		start_bump(p);
+		return bump_block(newSize, zeroed);
+	}
+	if(zeroed != NULL)
+	{
+		//set_allocated clears the free list pointers in front of the zero bytes
+		*zeroed = zeroed_start(p);
+		if(*zeroed <= (char *)p + sizeof(freePointerBlock))
+		{
+			*zeroed = p;
+		}
+	}
+	
+	set_allocated(p, newSize);
+	current_avail_size -= newSize;
+	biggestFreeSize = findBiggestFreeBlock();
+	return p;
+}
+
+
+
+/*
+* Free allocated block ptr, coalesce it and put it on the free list.
+*/
+static void free_block(void *ptr)
+{
+	size_t size = GET_SIZE(HDRP(ptr));
+	if(size <= QUICK_MAX_SIZE && quickCount[size/ALIGNMENT] < QUICK_COUNT_MAX)
+	{
+		if(quickBytes + size > QUICK_BYTES_MAX)
+		{
+			flush_quick_lists();
+		}
+		//the block stays allocated as far as its neighbors can tell
+		GET_ALLOC(HDRP(ptr)) = QUICK_BLOCK;
+		mark_block(ptr);
+		mark_dirty(ptr);
+		GET_NEXT_FREE_PTR(ptr) = quickLists[size/ALIGNMENT];
+		quickLists[size/ALIGNMENT] = ptr;
+		quickCount[size/ALIGNMENT]++;
+		quickBytes += size;
+	}
+	else
+	{
+		release_block(ptr);
+	}
+	if(++opCount % PURGE_INTERVAL == 0)
+	{
+		purge_free_blocks();
+	}
+}
+
+/*
+* Cap the zero bytes counted in the footer of free block bp at what fits
+* in it, after bp was split off the back of a bigger free block.
+*/
+static inline void trim_zeroed(void *bp)
+{
+	if(GET_ZEROED(FTRP(bp)) > ZEROED_MAX(bp))
+	{
+		GET_ZEROED(FTRP(bp)) = ZEROED_MAX(bp);
+	}
+}
+
+/*
+* Where the known-zero bytes before free block bp's footer start. Nothing
+* writes a count bigger than the block, so one that is was mangled, and
+* building a pointer from it would point anywhere; the heap is given up
+* and no bytes count as zero.
+*/
+static inline char *zeroed_start(void *bp)
+{
+	if(GET_ZEROED(FTRP(bp)) > ZEROED_MAX(bp))
+	{
+		heap_corrupt();
+		return FTRP(bp);
+	}
+	return FTRP(bp) - GET_ZEROED(FTRP(bp));
+}
+
+/*
+* Find biggest unallocated block size.
+*/
+static size_t findBiggestFreeBlock()
+{
+	size_t tempBiggest = 0;
+	void *p = freeListPtr;
+	if(p == NULL || heapCorrupt)
+	{
+		return tempBiggest;
+	}
+	if(!checking)
+	{
+		//kept apart from the checked walk below, since even a test of
+		//checking inside this loop makes it about twice as slow
+		while(GET_NEXT_FREE_PTR(p) != NULL)
+		{
+			if(GET_SIZE(HDRP(p)) > tempBiggest)
+			{
+				tempBiggest = GET_SIZE(HDRP(p));
+			}
+			p = GET_NEXT_FREE_PTR(p);
+		}
+		//the last node counts too; extend appends fresh chunks there
+		return GET_SIZE(HDRP(p)) > tempBiggest ? GET_SIZE(HDRP(p)) : tempBiggest;
+	}
+	if(!free_node_ok(p))
+	{
+		heap_corrupt();
+		return tempBiggest;
+	}
+	while(GET_NEXT_FREE_PTR(p) != NULL)
+	{
+		if(GET_SIZE(HDRP(p)) > tempBiggest)
+		{
+			tempBiggest = GET_SIZE(HDRP(p));
+		}
+		if(!next_free_ok(p))
+		{
+			heap_corrupt();
+			return tempBiggest;
+		}
+		p = GET_NEXT_FREE_PTR(p);
+	}
+	return GET_SIZE(HDRP(p)) > tempBiggest ? GET_SIZE(HDRP(p)) : tempBiggest;
+}
+
+/*
+* Purge the interior pages of free blocks that have been left alone for
+* PURGE_AGE ops. The first and last pages stay, since they hold the
+* header, free list pointers and footer. Pages are purged in whole units
+* of the chunk's granularity: a hugetlb page can only be dropped whole,
+* and dropping part of a transparent huge page splits it. The purged
+* pages read as zero, so the rest of the last page is cleared too and
+* the whole run up to the footer counts as zeroed.
+*/
+static void purge_free_blocks(void)
+{
+	void *p = freeListPtr;
+	if(heapCorrupt || (checking && p != NULL && !free_node_ok(p)))
+	{
+		return;
+	}
+	while(p != NULL)
+	{
+		if(GET_SIZE(HDRP(p)) >= PURGE_MIN_SIZE && !GET_PURGED(HDRP(p))
+			&& opCount - GET_TOUCHED(HDRP(p)) >= PURGE_AGE)
+		{
+			size_t grain = mem_granularity(p);
+			char *start = (char *)(((size_t)p + sizeof(freePointerBlock) + grain-1) & ~(grain-1));
+			char *end = (char *)((size_t)FTRP(p) & ~(grain-1));
+			if(end > start)
+			{
+				char *zeroed = zeroed_start(p);
+				if(heapCorrupt)
+				{
+					return;
+				}
+				if(mem_purge(start, end - start))
+				{
+					if(zeroed > end)
+					{
+						memset(end, 0, zeroed - end);
+					}
+					if(zeroed > start)
+					{
+						GET_ZEROED(FTRP(p)) = FTRP(p) - start;
+					}
+				}
+			}
+			GET_PURGED(HDRP(p)) = 1;
+		}
+		if(checking && GET_NEXT_FREE_PTR(p) != NULL && !next_free_ok(p))
+		{
+			heap_corrupt();
+			return;
+		}
+		p = GET_NEXT_FREE_PTR(p);
+	}
+}
+
+static int checkIsMangled(void *p)
+{
+	void* changedP = ADDRESS_PAGE_START(p);
+    return !mem_is_mapped(changedP, PAGE_ALIGN((p + sizeof(pageHeaderBlock)) - changedP));
+}
+
+
+static void removeFromFreeList(void *bp)
+{
+	if(checking && !links_ok(bp))
+	{
+		heap_corrupt();
+		return;
+	}
+	if(bp == currentRegion)
+	{
+		currentRegion = NULL;
+	}
+	if(GET_NEXT_FREE_PTR(bp) != NULL)
+	{
+		mark_dirty(GET_NEXT_FREE_PTR(bp));
+	}
+	if(GET_PREV_FREE_PTR(bp) != NULL)
+	{
+		mark_dirty(GET_PREV_FREE_PTR(bp));
+	}
 	if(GET_NEXT_FREE_PTR(bp) != NULL && GET_PREV_FREE_PTR(bp) != NULL) //normal, middle of list
 	{
 		GET_PREV_FREE_PTR(GET_NEXT_FREE_PTR(bp)) = GET_PREV_FREE_PTR(bp);
@@ -437,6 +2171,7 @@ static void addToFrontOfFreeList(void *ptr)
 	}
 	else
 	{
+		mark_dirty(freeListPtr);
 		GET_NEXT_FREE_PTR(ptr) = freeListPtr;
 		GET_PREV_FREE_PTR(freeListPtr) = ptr;
 		freeListPtr = ptr;
@@ -444,3 +2179,365 @@ static void addToFrontOfFreeList(void *ptr)
 	}
 }
 
+/*
+* Remember a newly mapped chunk by appending it, so the table is in
+* mapping order rather than address order. Entries never move, since
+* mem_set_owner tags every page with a pointer to its chunk's entry, and
+* free_before relies on the order to search back through older chunks.
+* Returns 0 if the table is full.
+*/
+static int add_chunk(void *start, size_t size)
+{
+	if(numChunks == MAX_CHUNKS)
+	{
+		return 0;
+	}
+	chunks[numChunks].start = start;
+	chunks[numChunks].size = size;
+	chunks[numChunks].starts = (unsigned long *)((char *)start + size - 2*BITMAP_BYTES(size));
+	chunks[numChunks].allocs = (unsigned long *)((char *)start + size - BITMAP_BYTES(size));
+	chunks[numChunks].end = (char *)chunks[numChunks].starts - sizeof(block_header);
+	chunks[numChunks].dirty = 1;
+	mem_set_owner(start, size, &chunks[numChunks]);
+	lastChunkFound = numChunks;
+	numChunks++;
+	return 1;
+}
+
+/*
+* Find the chunk that holds address p, or NULL if p isn't in the heap.
+* The page's owner tag says which chunk it is, so this is O(1) however
+* many chunks there are.
+*/
+static inline chunkRecord *find_chunk(void *p)
+{
+	chunkRecord *c = &chunks[lastChunkFound];
+	if((size_t)((char *)p - c->start) < c->size)
+	{
+		return c;
+	}
+	c = mem_owner(p);
+	//huge blocks and unmapped pages have some other owner
+	if(c < chunks || c >= chunks + numChunks)
+	{
+		return NULL;
+	}
+	lastChunkFound = c - chunks;
+	return c;
+}
+
+/*
+* Hash header h's address, size and allocated value with checkKey. A
+* header someone else wrote, or one left behind inside a bigger block,
+* fails this check.
+*/
+static inline unsigned short header_check(void *h)
+{
+	size_t x = ((size_t)h ^ checkKey) + GET_SIZE(h) * 0xff51afd7ed558ccdULL + (unsigned char)GET_ALLOC(h);
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	return (unsigned short)(x >> 48);
+}
+
+/*
+* Check that bp looks like a block in chunk c: aligned, a sane size that
+* stays inside the chunk, a known allocated value and a matching check.
+* Reads nothing outside the chunk.
+*/
+static inline int header_ok(void *bp, chunkRecord *c)
+{
+	char *h = HDRP(bp);
+	char *end = c->end;
+	size_t size;
+	if(((size_t)bp & (ALIGNMENT-1)) != 0 || h < c->start + ALIGNMENT || h >= end)
+	{
+		return 0;
+	}
+	size = GET_SIZE(h);
+	if(size < OVERHEAD || (size & (ALIGNMENT-1)) != 0 || size > (size_t)(end - h))
+	{
+		return 0;
+	}
+	return (GET_ALLOC(h) == 0 || GET_ALLOC(h) == 1 || GET_ALLOC(h) == QUICK_BLOCK)
+		&& GET_CHECK(h) == header_check(h);
+}
+
+/*
+* Like header_ok, but also check that the footer agrees with the header.
+*/
+static int block_ok(void *bp, chunkRecord *c)
+{
+	return header_ok(bp, c) && GET_SIZE(FTRP(bp)) == GET_SIZE(HDRP(bp));
+}
+
+/*
+* Check that bp is a free block somewhere in the heap.
+*/
+static int free_node_ok(void *bp)
+{
+	chunkRecord *c = find_chunk(HDRP(bp));
+	return c != NULL && block_ok(bp, c) && GET_ALLOC(HDRP(bp)) == 0;
+}
+
+/*
+* Check the free list link out of free block bp before following it.
+* Only the next block's header is read, to keep walks cheap; footers are
+* checked when a block is actually used.
+*/
+static int next_free_ok(void *bp)
+{
+	void *next = GET_NEXT_FREE_PTR(bp);
+	chunkRecord *c = find_chunk(HDRP(next));
+	return c != NULL && header_ok(next, c) && GET_ALLOC(HDRP(next)) == 0
+		&& GET_PREV_FREE_PTR(next) == bp;
+}
+
+/*
+* Check that both free list links of bp point back at it.
+*/
+static int links_ok(void *bp)
+{
+	void *next = GET_NEXT_FREE_PTR(bp);
+	void *prev = GET_PREV_FREE_PTR(bp);
+	if(next == NULL ? bp != endFreeListPtr : !next_free_ok(bp))
+	{
+		return 0;
+	}
+	if(prev == NULL)
+	{
+		return bp == freeListPtr;
+	}
+	return free_node_ok(prev) && GET_NEXT_FREE_PTR(prev) == bp;
+}
+
+/*
+* Check the blocks on either side of bp, which are needed to coalesce it.
+* The one after may be the chunk's terminator.
+*/
+static int neighbors_ok(void *bp, chunkRecord *c)
+{
+	if(c == NULL)
+	{
+		return 0;
+	}
+	char *h = HDRP(bp);
+	if(h > c->start + ALIGNMENT) //not the prologue, so there is a block before
+	{
+		size_t prevSize = GET_SIZE((char *)bp - OVERHEAD);
+		if(prevSize > (size_t)(h - c->start) || !block_ok((char *)bp - prevSize, c))
+		{
+			return 0;
+		}
+	}
+	char *next = NEXT_BLKP(bp);
+	if(HDRP(next) == c->end)
+	{
+		return GET_SIZE(HDRP(next)) == 0 && GET_ALLOC(HDRP(next)) == 1;
+	}
+	return block_ok(next, c);
+}
+
+/*
+* Check a block that changed since the last check: its boundary tags,
+* its neighbors, and if it is free, its links and that it was coalesced.
+*/
+static int check_block(void *bp)
+{
+	chunkRecord *c = find_chunk(HDRP(bp));
+	if(c == NULL || !block_ok(bp, c) || !neighbors_ok(bp, c)
+		|| block_bits(c, bp) != (GET_ALLOC(HDRP(bp)) ? BIT_START|BIT_ALLOC : BIT_START))
+	{
+		return 0;
+	}
+	if(GET_ALLOC(HDRP(bp)))
+	{
+		return 1;
+	}
+	return links_ok(bp) && GET_ALLOC(HDRP(PREV_BLKP(bp))) && GET_ALLOC(HDRP(NEXT_BLKP(bp)));
+}
+
+/*
+* Check a chunk's page links, prologue and terminator. With walk set,
+* also check every block in it and add its free blocks to freeCount.
+*/
+static int check_chunk(chunkRecord *c, int walk, size_t *freeCount)
+{
+	void *next = GET_NEXT_PAGE_PTR(c->start);
+	void *prev = GET_PREV_PAGE_PTR(c->start);
+	char *end = c->end;
+	if((next != NULL && (find_chunk(next) == NULL || find_chunk(next)->start != next))
+		|| (prev != NULL && (find_chunk(prev) == NULL || find_chunk(prev)->start != prev)))
+	{
+		return 0;
+	}
+	if(GET_SIZE(end) != 0 || GET_ALLOC(end) != 1 || GET_CHECK(end) != header_check(end))
+	{
+		return 0;
+	}
+	void *bp = c->start + 2*ALIGNMENT;
+	if(!block_ok(bp, c) || GET_SIZE(HDRP(bp)) != OVERHEAD || GET_ALLOC(HDRP(bp)) != 1)
+	{
+		return 0;
+	}
+	if(!walk)
+	{
+		return 1;
+	}
+	int prevFree = 0;
+	size_t blocks = 1, marked = 0, i;
+	for(bp = NEXT_BLKP(bp); HDRP(bp) != end; bp = NEXT_BLKP(bp))
+	{
+		if(!block_ok(bp, c)
+			|| block_bits(c, bp) != (GET_ALLOC(HDRP(bp)) ? BIT_START|BIT_ALLOC : BIT_START))
+		{
+			return 0;
+		}
+		blocks++;
+		if(!GET_ALLOC(HDRP(bp)))
+		{
+			if(prevFree)
+			{
+				return 0; //two free blocks in a row weren't coalesced
+			}
+			(*freeCount)++;
+		}
+		prevFree = !GET_ALLOC(HDRP(bp));
+	}
+	//every block's bits were right, so any extra bit is a stale one
+	for(i = 0; i < BITMAP_BYTES(c->size) / sizeof(unsigned long); i++)
+	{
+		marked += __builtin_popcountl(c->starts[i]);
+	}
+	return marked == blocks;
+}
+
+/*
+* The bitmap bits recorded for bp in chunk c: 0 if no block starts there,
+* otherwise BIT_START, plus BIT_ALLOC when the block is allocated.
+*/
+static inline int block_bits(chunkRecord *c, void *bp)
+{
+	size_t i = ((char *)bp - c->start) / ALIGNMENT;
+	unsigned long bit = 1UL << (i % WORD_BITS);
+	if(!(c->starts[i / WORD_BITS] & bit))
+	{
+		return 0;
+	}
+	return (c->allocs[i / WORD_BITS] & bit) ? BIT_START|BIT_ALLOC : BIT_START;
+}
+
+/*
+* Seal bp's header and record it in its chunk's bitmaps, once its size
+* and allocated value are final.
+*/
+static void mark_block(void *bp)
+{
+	chunkRecord *c = find_chunk(HDRP(bp));
+	SEAL(bp);
+	if(c == NULL)
+	{
+		return;
+	}
+	size_t i = ((char *)bp - c->start) / ALIGNMENT;
+	unsigned long bit = 1UL << (i % WORD_BITS);
+	c->starts[i / WORD_BITS] |= bit;
+	if(GET_ALLOC(HDRP(bp)))
+	{
+		c->allocs[i / WORD_BITS] |= bit;
+	}
+	else
+	{
+		c->allocs[i / WORD_BITS] &= ~bit;
+	}
+}
+
+/*
+* Clear the bits of bp, which was just merged into the block before it.
+*/
+static void unmark_block(void *bp)
+{
+	chunkRecord *c = find_chunk(HDRP(bp));
+	if(c == NULL)
+	{
+		return;
+	}
+	size_t i = ((char *)bp - c->start) / ALIGNMENT;
+	unsigned long bit = 1UL << (i % WORD_BITS);
+	c->starts[i / WORD_BITS] &= ~bit;
+	c->allocs[i / WORD_BITS] &= ~bit;
+}
+
+/*
+* Walk the whole free list, checking each link, and make sure it holds
+* exactly the freeCount free blocks found in the chunks.
+*/
+static int check_free_list(size_t freeCount)
+{
+	void *p = freeListPtr;
+	size_t count = 0;
+	if(p == NULL)
+	{
+		return freeCount == 0 && endFreeListPtr == NULL;
+	}
+	if(!free_node_ok(p) || GET_PREV_FREE_PTR(p) != NULL)
+	{
+		return 0;
+	}
+	while(++count <= freeCount)
+	{
+		if(GET_NEXT_FREE_PTR(p) == NULL)
+		{
+			return p == endFreeListPtr && count == freeCount;
+		}
+		if(!next_free_ok(p))
+		{
+			return 0;
+		}
+		p = GET_NEXT_FREE_PTR(p);
+	}
+	return 0; //more nodes than free blocks, so there is a cycle
+}
+
+/*
+* Give up on the heap: mm_check fails from now on, and mm_malloc maps
+* every block on its own until mm_init. Returns 0 for mm_check.
+*/
+static int heap_corrupt(void)
+{
+	heapCorrupt = 1;
+	return 0;
+}
+
+/*
+* Note that block bp changed, so the next mm_check looks at it.
+*/
+static void mark_dirty(void *bp)
+{
+	if(numDirty < DIRTY_MAX)
+	{
+		dirtyBlocks[numDirty++] = bp;
+	}
+	else
+	{
+		checkAll = 1;
+	}
+}
+
+/*
+* Forget bp when it is merged into another block and is no longer a
+* block of its own.
+*/
+static void unmark_dirty(void *bp)
+{
+	int i;
+	if(checkAll)
+	{
+		return;
+	}
+	for(i = 0; i < numDirty; i++)
+	{
+		if(dirtyBlocks[i] == bp)
+		{
+			dirtyBlocks[i--] = dirtyBlocks[--numDirty];
+		}
+	}
+}
@@ -2,7 +2,52 @@
 
 extern int mm_init(void);
 extern void *mm_malloc(size_t size);
+extern void *mm_calloc(size_t nmemb, size_t size);
 extern void mm_free(void *ptr);
+extern void mm_free_sized(void *ptr, size_t size);
+extern size_t mm_malloc_batch(size_t size, size_t n, void **out);
+extern void mm_free_batch(void **ptrs, size_t n);
+extern void *mm_realloc(void *ptr, size_t size);
+extern void *mm_memalign(size_t align, size_t size);
+extern size_t mm_usable_size(void *ptr);
+extern size_t mm_good_size(size_t size);
+extern void mm_realloc_stats(size_t *copied, size_t *remapped);
+
+/* Free-list orders for mm_set_free_order */
+#define MM_ORDER_LIFO    0  /* freed blocks go to the front */
+#define MM_ORDER_ADDRESS 1  /* blocks are kept in address order */
+extern int mm_set_free_order(int order);
+
+/* Placement policies for mm_set_placement */
+#define MM_PLACE_FIRST_FIT 0  /* first block on the free list that fits */
+#define MM_PLACE_LOCAL     1  /* the block the last allocation came from first */
+extern int mm_set_placement(int policy);
+
+extern void mm_free_summary(size_t *count, size_t *largest);
+
+/* Hot-path counters, kept only when mm.c is built with MM_STATS=1 */
+typedef struct {
+  size_t mallocs;        /* mm_malloc calls that searched the free list */
+  size_t nodes_visited;  /* free-list nodes looked at by those searches */
+  size_t max_visited;    /* most nodes looked at by a single search */
+  size_t bin_hits;       /* searches where the first node looked at fit */
+  size_t bin_misses;     /* searches that had to step past a node too small */
+  size_t region_hits;    /* searches served by the last allocation's block */
+  size_t bumps;          /* mallocs carved from the bump region, without a search */
+  size_t failed_fits;    /* searches with no fit, so the heap was extended */
+  size_t splits;         /* free blocks split by an allocation */
+  size_t coalesce[4];    /* frees by coalesce case 1-4 */
+  size_t extends;        /* extend calls that mapped a new chunk */
+  size_t grows;          /* extend calls that grew the last chunk in place */
+  size_t bytes_mapped;   /* bytes mapped by extend and for huge blocks */
+  size_t calloc_bytes;   /* bytes asked for by mm_calloc */
+  size_t calloc_cleared; /* of those, bytes it had to clear with memset */
+  size_t quick_hits;     /* mallocs served from the quick lists */
+  size_t quick_flushes;  /* times the quick lists were coalesced */
+} mm_stats_t;
+
+extern int mm_stats(mm_stats_t *stats);
 
 extern int mm_check(void);
 extern int mm_can_free(void *ptr);
+extern void *mm_block_lookup(void *addr);
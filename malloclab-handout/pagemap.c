@@ -8,6 +8,8 @@
 
 typedef struct mpage {
   void *addr;
+  int flags;
+  void *owner;
   struct mpage *prev, *next;
 } mpage;
 
@@ -56,6 +58,8 @@ void pagemap_modify(void *p, int mapped) {
     if (page == all_mapped_pages)
       abort();
     page->addr = p;
+    page->flags = 0;
+    page->owner = NULL;
     page->prev = NULL;
     page->next = all_mapped_pages;
     if (all_mapped_pages)
@@ -76,16 +80,49 @@ void pagemap_modify(void *p, int mapped) {
   }
 }
 
-int pagemap_is_mapped(void *p) {
+static mpage *find_page(void *p) {
   mpage **page_maps2;
   mpage *page_maps3;
 
-  if (!page_maps1) return 0;
+  if (!page_maps1) return NULL;
   page_maps2 = page_maps1[PAGEMAP64_LEVEL1_BITS(p)];
-  if (!page_maps2) return 0;
+  if (!page_maps2) return NULL;
   page_maps3 = page_maps2[PAGEMAP64_LEVEL2_BITS(p)];
-  if (!page_maps3) return 0;
-  return !!page_maps3[PAGEMAP64_LEVEL3_BITS(p)].addr;
+  if (!page_maps3) return NULL;
+  return &page_maps3[PAGEMAP64_LEVEL3_BITS(p)];
+}
+
+int pagemap_is_mapped(void *p) {
+  mpage *page = find_page(p);
+  return page && page->addr;
+}
+
+void pagemap_set_flags(void *p, int flags) {
+  mpage *page = find_page(p);
+  if (!page || !page->addr) {
+    fprintf(stderr, "internal error: setting flags on unmapped page\n");
+    abort();
+  }
+  page->flags = flags;
+}
+
+int pagemap_flags(void *p) {
+  mpage *page = find_page(p);
+  return (page && page->addr) ? page->flags : 0;
+}
+
+void pagemap_set_owner(void *p, void *owner) {
+  mpage *page = find_page(p);
+  if (!page || !page->addr) {
+    fprintf(stderr, "internal error: setting owner of unmapped page\n");
+    abort();
+  }
+  page->owner = owner;
+}
+
+void *pagemap_owner(void *p) {
+  mpage *page = find_page(p);
+  return (page && page->addr) ? page->owner : NULL;
 }
 
 void pagemap_for_each(page_callback f, int do_unmap) {
@@ -3,8 +3,21 @@ typedef void (*page_callback)(void *addr);
 
 void pagemap_modify(void *addr, int mapped);
 int pagemap_is_mapped(void *addr);
+void pagemap_set_flags(void *addr, int flags);
+int pagemap_flags(void *addr);
+void pagemap_set_owner(void *addr, void *owner);
+void *pagemap_owner(void *addr);
 void pagemap_for_each(page_callback f, int do_unmap);
 
 /* APAGE_SIZE needs to match the actual page size */
 #define LOG_APAGE_SIZE 12
 #define APAGE_SIZE (1 << LOG_APAGE_SIZE)
+
+/* HPAGE_SIZE is the huge-page size used by mem_map_huge */
+#define LOG_HPAGE_SIZE 21
+#define HPAGE_SIZE (1 << LOG_HPAGE_SIZE)
+
+/* flags recorded per page by memlib */
+#define PAGEMAP_HUGE    0x1  /* part of a 2MB-aligned, THP-advised mapping */
+#define PAGEMAP_HUGETLB 0x2  /* part of a MAP_HUGETLB mapping */
+#define PAGEMAP_PURGED  0x4  /* released with mem_purge, not yet reused */
@@ -0,0 +1,132 @@
+/*
+ * perfctr.c - Count hardware events used by a function f
+ *
+ * Counters are opened for the calling thread only and count user-mode
+ * events, which works with the default perf_event_paranoid setting.
+ * When the kernel or container refuses a counter (no PMU, seccomp,
+ * paranoid level 3), that event is simply reported as unavailable.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "perfctr.h"
+
+typedef struct {
+    const char *name;
+    unsigned type;
+    unsigned long long config;
+} perfctr_event;
+
+#define HW_CACHE_CONFIG(cache, op, result) \
+    ((cache) | ((op) << 8) | ((result) << 16))
+
+static const perfctr_event events[PERFCTR_NUM_EVENTS] = {
+    { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "L1d-misses", PERF_TYPE_HW_CACHE,
+      HW_CACHE_CONFIG(PERF_COUNT_HW_CACHE_L1D,
+                      PERF_COUNT_HW_CACHE_OP_READ,
+                      PERF_COUNT_HW_CACHE_RESULT_MISS) },
+    { "LLC-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "dTLB-misses", PERF_TYPE_HW_CACHE,
+      HW_CACHE_CONFIG(PERF_COUNT_HW_CACHE_DTLB,
+                      PERF_COUNT_HW_CACHE_OP_READ,
+                      PERF_COUNT_HW_CACHE_RESULT_MISS) },
+    { "branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+};
+
+/* What read() returns for each counter */
+typedef struct {
+    unsigned long long value;
+    unsigned long long time_enabled;
+    unsigned long long time_running;
+} perfctr_reading;
+
+static int fds[PERFCTR_NUM_EVENTS];
+static int initialized = 0;
+
+static int open_event(const perfctr_event *e)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = e->type;
+    attr.config = e->config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/*
+ * init_perfctr - open one counter per event
+ */
+int init_perfctr(void)
+{
+    int i, n = 0;
+
+    if (!initialized) {
+	for (i = 0; i < PERFCTR_NUM_EVENTS; i++) {
+	    fds[i] = open_event(&events[i]);
+	    if (fds[i] >= 0)
+		n++;
+	}
+	initialized = 1;
+    } else {
+	for (i = 0; i < PERFCTR_NUM_EVENTS; i++)
+	    if (fds[i] >= 0)
+		n++;
+    }
+    return n;
+}
+
+int perfctr_available(int event)
+{
+    return initialized && fds[event] >= 0;
+}
+
+const char *perfctr_name(int event)
+{
+    return events[event].name;
+}
+
+/*
+ * perfctr_measure - Count the events caused by one run of f(argp)
+ */
+void perfctr_measure(perfctr_test_funct f, void *argp, long long *counts)
+{
+    int i;
+    perfctr_reading r;
+
+    if (!initialized)
+	init_perfctr();
+
+    for (i = 0; i < PERFCTR_NUM_EVENTS; i++) {
+	if (fds[i] >= 0) {
+	    ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+	    ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+    }
+
+    f(argp);
+
+    for (i = 0; i < PERFCTR_NUM_EVENTS; i++) {
+	if (fds[i] >= 0) {
+	    ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+	    if (read(fds[i], &r, sizeof(r)) != sizeof(r) || r.time_running == 0)
+		counts[i] = -1;
+	    else if (r.time_running < r.time_enabled)
+		counts[i] = (long long)((double)r.value * r.time_enabled / r.time_running);
+	    else
+		counts[i] = r.value;
+	} else
+	    counts[i] = -1;
+    }
+}
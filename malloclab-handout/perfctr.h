@@ -0,0 +1,31 @@
+/*
+ * perfctr.h - hardware event counters around a test function,
+ *     using Linux perf_event_open
+ */
+
+/* The test function takes a generic pointer as input */
+typedef void (*perfctr_test_funct)(void *);
+
+/* Events that can be counted */
+#define PERFCTR_CYCLES        0   /* CPU cycles */
+#define PERFCTR_INSTRUCTIONS  1   /* instructions retired */
+#define PERFCTR_L1D_MISSES    2   /* L1 data cache read misses */
+#define PERFCTR_LLC_MISSES    3   /* last-level cache misses */
+#define PERFCTR_DTLB_MISSES   4   /* dTLB read misses */
+#define PERFCTR_BRANCH_MISSES 5   /* mispredicted branches */
+#define PERFCTR_NUM_EVENTS    6
+
+/* Open the counters; returns the number of events that are available */
+int init_perfctr(void);
+
+/* Is the given event available on this machine? */
+int perfctr_available(int event);
+
+/* Printable name of an event */
+const char *perfctr_name(int event);
+
+/* Run f(argp) once with the counters enabled. counts[] receives one
+   value per event, or -1 for events that are not available. When the
+   PMU has to multiplex the counters, counts are scaled up to the full
+   run. */
+void perfctr_measure(perfctr_test_funct f, void *argp, long long *counts);
@@ -0,0 +1,42 @@
+#!/usr/bin/perl
+#!/usr/local/bin/perl
+
+$out_filename = "bigrealloc.rep";
+$realloc_size = 16384;
+$size_increment = 24576;
+$malloc_size = 96;
+$num_iters = 160;
+
+# Open output file
+open OUTFILE, ">$out_filename" or die "Cannot create $out_filename\n";
+
+# Two buffers grow alternately, in the style of doubling vectors that
+# have outgrown doubling, with small short-lived blocks in between
+
+$suggested_heap_size = 2*($realloc_size+$size_increment*$num_iters)+$malloc_size*2+100;
+$num_blocks = $num_iters + 2;
+$num_ops = 4 * $num_iters + 4;
+$blk = 2;
+
+print OUTFILE "$suggested_heap_size\n";
+print OUTFILE "$num_blocks\n";
+print OUTFILE "$num_ops\n";
+print OUTFILE "1\n";
+
+print OUTFILE "a 0 $realloc_size\n";
+print OUTFILE "a 1 $realloc_size\n";
+
+for ($i = 0;  $i < $num_iters; $i += 1) {
+	$realloc_size += $size_increment;
+
+	print OUTFILE "r 0 $realloc_size\n";
+	print OUTFILE "a $blk $malloc_size\n";
+	print OUTFILE "r 1 $realloc_size\n";
+	print OUTFILE "f $blk\n";
+	$blk += 1;
+}
+
+print OUTFILE "f 0\n";
+print OUTFILE "f 1\n";
+
+close OUTFILE;
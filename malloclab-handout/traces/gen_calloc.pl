@@ -0,0 +1,72 @@
+#!/usr/bin/perl
+#!/usr/local/bin/perl
+
+$out_filename = "calloc.rep";
+$num_blocks = 3000;
+$max_nmemb = 128;
+$max_big_size = 65536;
+
+# Seeded so that the trace can be regenerated exactly
+srand(4401);
+
+# Make a series of malloc()s and calloc()s: zeroed arrays of small
+# structs, and the odd big zeroed table that should come from fresh
+# or purged pages
+for ($i = 0;  $i < $num_blocks; $i += 1) {
+    $op = {};
+    $op->{seq} = $i;
+    $r = rand;
+    if ($r < 0.3) {
+        $op->{type} = "a";
+        $op->{size} = int(rand 1024) + 1;
+    } elsif ($r < 0.9) {
+        $op->{type} = "c";
+        $op->{nmemb} = int(rand $max_nmemb) + 1;
+        $op->{elem} = (4, 8, 16, 24)[int(rand 4)];
+        $op->{size} = $op->{nmemb} * $op->{elem};
+    } else {
+        $op->{type} = "c";
+        $op->{nmemb} = 1;
+        $op->{elem} = int(rand $max_big_size) + 4096;
+        $op->{size} = $op->{elem};
+    }
+    $total_block_size += $op->{size};
+    push @trace, $op;
+}
+# Insert free()s in proper places
+for ($i = 0;  $i < $num_blocks; $i += 1) {
+    for ($minval = $i; $minval < $num_blocks + $i; $minval += 1) {
+        if (($trace[$minval]->{type} ne "f") && ($trace[$minval]->{seq} == $i)) {
+            last;
+        }
+    }
+    $pos = int(rand($num_blocks + $i - $minval - 1) + $minval + 1);
+    $op = {};
+    $op->{type} = "f";
+    $op->{seq} = $i;
+    splice @trace, $pos, 0, $op;
+}
+
+# Open output file
+open OUTFILE, ">$out_filename" or die "Cannot create $out_filename\n";
+
+# Calculate misc parameters
+$suggested_heap_size = $total_block_size + 100;
+$num_ops = 2*$num_blocks;
+
+print OUTFILE "$suggested_heap_size\n";
+print OUTFILE "$num_blocks\n";
+print OUTFILE "$num_ops\n";
+print OUTFILE "1\n";
+
+for ($i = 0;  $i < 2*$num_blocks; $i += 1) {
+    if ($trace[$i]->{type} eq "a") {
+        print OUTFILE "a $trace[$i]->{seq} $trace[$i]->{size}\n";
+    } elsif ($trace[$i]->{type} eq "c") {
+        print OUTFILE "c $trace[$i]->{seq} $trace[$i]->{nmemb} $trace[$i]->{elem}\n";
+    } else {
+        print OUTFILE "f $trace[$i]->{seq}\n";
+    }
+}
+
+close OUTFILE;
@@ -0,0 +1,69 @@
+#!/usr/bin/perl
+#!/usr/local/bin/perl
+
+$out_filename = "memalign.rep";
+$num_blocks = 2400;
+$max_blk_size = 1024;
+$page_blk_size = 16384;
+
+# Seeded so that the trace can be regenerated exactly
+srand(4400);
+
+# Make a series of malloc()s and memalign()s: cache-line sized
+# alignments for small buffers, and the odd page-aligned buffer
+for ($i = 0;  $i < $num_blocks; $i += 1) {
+    $op = {};
+    $op->{seq} = $i;
+    $r = rand;
+    if ($r < 0.5) {
+        $op->{type} = "a";
+        $op->{size} = int(rand $max_blk_size) + 1;
+    } elsif ($r < 0.95) {
+        $op->{type} = "m";
+        $op->{align} = (32, 64, 64, 128)[int(rand 4)];
+        $op->{size} = int(rand $max_blk_size) + 1;
+    } else {
+        $op->{type} = "m";
+        $op->{align} = 4096;
+        $op->{size} = 4096 * (int(rand ($page_blk_size / 4096)) + 1);
+    }
+    $total_block_size += $op->{size};
+    push @trace, $op;
+}
+# Insert free()s in proper places
+for ($i = 0;  $i < $num_blocks; $i += 1) {
+    for ($minval = $i; $minval < $num_blocks + $i; $minval += 1) {
+        if (($trace[$minval]->{type} ne "f") && ($trace[$minval]->{seq} == $i)) {
+            last;
+        }
+    }
+    $pos = int(rand($num_blocks + $i - $minval - 1) + $minval + 1);
+    $op = {};
+    $op->{type} = "f";
+    $op->{seq} = $i;
+    splice @trace, $pos, 0, $op;
+}
+
+# Open output file
+open OUTFILE, ">$out_filename" or die "Cannot create $out_filename\n";
+
+# Calculate misc parameters
+$suggested_heap_size = $total_block_size + 100;
+$num_ops = 2*$num_blocks;
+
+print OUTFILE "$suggested_heap_size\n";
+print OUTFILE "$num_blocks\n";
+print OUTFILE "$num_ops\n";
+print OUTFILE "1\n";
+
+for ($i = 0;  $i < 2*$num_blocks; $i += 1) {
+    if ($trace[$i]->{type} eq "a") {
+        print OUTFILE "a $trace[$i]->{seq} $trace[$i]->{size}\n";
+    } elsif ($trace[$i]->{type} eq "m") {
+        print OUTFILE "m $trace[$i]->{seq} $trace[$i]->{align} $trace[$i]->{size}\n";
+    } else {
+        print OUTFILE "f $trace[$i]->{seq}\n";
+    }
+}
+
+close OUTFILE;